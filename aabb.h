@@ -0,0 +1,107 @@
+/***
+ * Axis aligned bounding boxes, possibly unbounded along some axes.
+ * Usage:
+ * #include "aabb.h"
+ * AABB box = AABB::around(center, radius) | other_box;
+ * if (box.isFinite() && box.distance(v) > 1) { ... }
+ *
+ * A default constructed box is infinite, which is always a valid (if useless)
+ * bound.
+ ***/
+
+#ifndef AABB_H
+#define AABB_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "vec3.h"
+
+struct AABB {
+  AABB() : min(-kInf, -kInf, -kInf), max(kInf, kInf, kInf) {}
+
+  AABB(const vec3& min, const vec3& max) : min(min), max(max) {}
+
+  // Contains nothing; the identity of operator|.
+  static AABB empty() {
+    return AABB(vec3(kInf, kInf, kInf), vec3(-kInf, -kInf, -kInf));
+  }
+
+  static AABB around(const vec3& center, float radius) {
+    vec3 r(radius, radius, radius);
+    return AABB(center - r, center + r);
+  }
+
+  bool isFinite() const {
+    return std::isfinite(min.x) && std::isfinite(min.y) &&
+           std::isfinite(min.z) && std::isfinite(max.x) &&
+           std::isfinite(max.y) && std::isfinite(max.z);
+  }
+
+  vec3 size() const {
+    return max - min;
+  }
+
+  // Union.
+  AABB operator|(const AABB& other) const {
+    return AABB(vec3(std::min(min.x, other.min.x), std::min(min.y, other.min.y),
+                     std::min(min.z, other.min.z)),
+                vec3(std::max(max.x, other.max.x), std::max(max.y, other.max.y),
+                     std::max(max.z, other.max.z)));
+  }
+
+  // Intersection.
+  AABB operator&(const AABB& other) const {
+    return AABB(vec3(std::max(min.x, other.min.x), std::max(min.y, other.min.y),
+                     std::max(min.z, other.min.z)),
+                vec3(std::min(max.x, other.max.x), std::min(max.y, other.max.y),
+                     std::min(max.z, other.max.z)));
+  }
+
+  AABB expand(float r) const {
+    vec3 d(r, r, r);
+    return AABB(min - d, max + d);
+  }
+
+  AABB translate(const vec3& t) const {
+    return AABB(min + t, max + t);
+  }
+
+  // The box of all points v such that (v.x * scale.x + offset.x, ...) is in
+  // this box.
+  AABB preimage(const vec3& scale, const vec3& offset) const {
+    AABB res;
+    preimage(min.x, max.x, scale.x, offset.x, &res.min.x, &res.max.x);
+    preimage(min.y, max.y, scale.y, offset.y, &res.min.y, &res.max.y);
+    preimage(min.z, max.z, scale.z, offset.z, &res.min.z, &res.max.z);
+    return res;
+  }
+
+  // Distance from v to the box, 0 inside it.
+  float distance(const vec3& v) const {
+    float dx = std::max({min.x - v.x, 0.0f, v.x - max.x});
+    float dy = std::max({min.y - v.y, 0.0f, v.y - max.y});
+    float dz = std::max({min.z - v.z, 0.0f, v.z - max.z});
+    return sqrt(dx * dx + dy * dy + dz * dz);
+  }
+
+  vec3 min;
+  vec3 max;
+
+ private:
+  static constexpr float kInf = std::numeric_limits<float>::infinity();
+
+  static void preimage(float lo, float hi, float scale, float offset,
+                       float* res_lo, float* res_hi) {
+    if (scale == 0) {
+      return;
+    }
+    float a = (lo - offset) / scale;
+    float b = (hi - offset) / scale;
+    *res_lo = std::min(a, b);
+    *res_hi = std::max(a, b);
+  }
+};
+
+#endif
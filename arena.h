@@ -0,0 +1,155 @@
+/***
+ * Bump allocator owning a group of objects which are all freed together.
+ * Usage:
+ * #include "arena.h"
+ * Arena arena;
+ * Sphere* s = arena.make<Sphere>(center, radius, material);
+ * std::cout << arena.str() << std::endl;  // Bytes used per type.
+ *
+ * Objects are laid out in allocation order in large blocks, so objects which
+ * are created together (e.g. the children of a node) end up next to each other
+ * in memory. Destructors run in reverse allocation order when the arena is
+ * destroyed.
+ ***/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cxxabi.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "logging.h"
+
+class Arena {
+ public:
+  explicit Arena(size_t block_size = 1 << 20) : block_size_(block_size) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  ~Arena() {
+    for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+      it->destroy(it->object);
+    }
+    for (Block& block : blocks_) {
+      free(block.data);
+    }
+  }
+
+  template <class T, class... Args>
+  T* make(Args&&... args) {
+    void* memory = allocate(sizeof(T), alignof(T));
+    T* object = new (memory) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors_.push_back(
+          {[](void* p) { static_cast<T*>(p)->~T(); }, object});
+    }
+    TypeStats& stats = stats_[std::type_index(typeid(T))];
+    stats.count++;
+    stats.bytes += sizeof(T);
+    return object;
+  }
+
+  void* allocate(size_t size, size_t alignment) {
+    if (blocks_.empty() || !fits(blocks_.back(), size, alignment)) {
+      size_t block_size = std::max(block_size_, size + alignment);
+      char* data = (char*)malloc(block_size);
+      CHECK(data != 0) << "failed to allocate arena block of " << block_size;
+      blocks_.push_back({data, block_size, 0});
+      bytes_reserved_ += block_size;
+    }
+    Block& block = blocks_.back();
+    size_t offset = alignUp(block, alignment);
+    block.used = offset + size;
+    bytes_used_ += size;
+    return block.data + offset;
+  }
+
+  size_t bytesUsed() const { return bytes_used_; }
+  size_t bytesReserved() const { return bytes_reserved_; }
+
+  std::string str() const {
+    std::map<std::string, TypeStats> by_name;
+    for (const auto& [type, stats] : stats_) {
+      TypeStats& s = by_name[demangle(type.name())];
+      s.count += stats.count;
+      s.bytes += stats.bytes;
+    }
+    std::vector<std::pair<std::string, TypeStats>> sorted(by_name.begin(),
+                                                          by_name.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+      return a.second.bytes > b.second.bytes;
+    });
+
+    std::stringstream res;
+    res << "Arena: " << bytes_used_ << " bytes used in " << blocks_.size()
+        << " blocks (" << bytes_reserved_ << " bytes reserved)" << std::endl;
+    for (const auto& [name, stats] : sorted) {
+      res << "  " << std::left << std::setw(30) << name << " " << std::right
+          << std::setw(10) << stats.count << " objects " << std::setw(12)
+          << stats.bytes << " bytes" << std::endl;
+    }
+    return res.str();
+  }
+
+ private:
+  struct Block {
+    char* data;
+    size_t size;
+    size_t used;
+  };
+
+  struct Destructor {
+    void (*destroy)(void*);
+    void* object;
+  };
+
+  struct TypeStats {
+    size_t count = 0;
+    size_t bytes = 0;
+  };
+
+  static size_t alignUp(const Block& block, size_t alignment) {
+    uintptr_t p = (uintptr_t)(block.data + block.used);
+    uintptr_t aligned = (p + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    return aligned - (uintptr_t)block.data;
+  }
+
+  static bool fits(const Block& block, size_t size, size_t alignment) {
+    return alignUp(block, alignment) + size <= block.size;
+  }
+
+  static std::string demangle(const char* name) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name, 0, 0, &status);
+    if (status != 0) {
+      return name;
+    }
+    std::string res(demangled);
+    free(demangled);
+    return res;
+  }
+
+  size_t block_size_;
+  size_t bytes_used_ = 0;
+  size_t bytes_reserved_ = 0;
+  std::vector<Block> blocks_;
+  std::vector<Destructor> destructors_;
+  std::unordered_map<std::type_index, TypeStats> stats_;
+};
+
+#endif
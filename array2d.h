@@ -1,13 +1,131 @@
+/***
+ * 2D arrays of values, stored row by row.
+ * Usage:
+ * #include "array2d.h"
+ * Array2D<float> arr(width, height);
+ * arr(x, y) = 1;
+ * arr *= 2;
+ * float total = arr.sum();
+ * // Rows padded so that walking down columns does not thrash the cache.
+ * Array2D<float> padded(width, height, Array2D<float>::paddedPitch(width));
+ * // A single loop over a and b, without temporary arrays.
+ * Array2D<float> average = (a + b) / 2;
+ * arr.serialize("/tmp/arr.img");
+ * Array2D<float> loaded(0, 0);
+ * loaded.map("/tmp/arr.img");  // Or deserialize, which reads all values.
+ *
+ * Storage is aligned to 64 bytes (a cache line). Row y starts pitch() values
+ * after row y - 1. By default pitch() == width() and the values are also
+ * reachable through flat indices arr(i), i < size(); arrays built with a
+ * larger pitch (see paddedPitch) must be accessed by (x, y) or through row
+ * pointers &arr(0, y). Element-wise operations process blocks of kLanes
+ * independent values, which the compiler turns into SIMD instructions.
+ *
+ * a + b, a * b, a * s and a / s (for arrays a, b and a scalar s) and
+ * combinations of them are lazy: they only hold references to their arrays,
+ * and are computed value by value when assigned to an Array2D. Do not keep
+ * them in `auto` variables which outlive the arrays. Calling sum, min, max or
+ * operator() on an expression computes it into an array which it keeps, so
+ * that writes through operator() show in later uses of the expression; eval
+ * returns the values as an Array2D.
+ *
+ * Files start with a 64 byte FileHeader: a magic number, the format version,
+ * the value type (see Array2DElement), the dimensions, the pitch and a
+ * checksum of the values. Then come the values of each row, followed by the
+ * padding up to the next row, so that map can use files as they are on disk.
+ * deserialize and map also read the older files without a header.
+ ***/
+
 #ifndef ARRAY2D_H
 #define ARRAY2D_H
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
 #include <cstring>
+#include <filesystem>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <valarray>
 
 #include "array_view.h"
 
+template <class value_type>
+class Array2D;
+
+// Identifies the value types of arrays in files, so that files are not read
+// as arrays of another type of the same size. Types without an id (0) are
+// only checked by size.
+template <class T>
+struct Array2DElement {
+  static constexpr uint32_t kId = 0;
+};
+
+template <>
+struct Array2DElement<float> {
+  static constexpr uint32_t kId = 1;
+};
+
+template <>
+struct Array2DElement<double> {
+  static constexpr uint32_t kId = 2;
+};
+
+template <>
+struct Array2DElement<int32_t> {
+  static constexpr uint32_t kId = 3;
+};
+
+template <>
+struct Array2DElement<uint8_t> {
+  static constexpr uint32_t kId = 4;
+};
+
+template <>
+struct Array2DElement<uint16_t> {
+  static constexpr uint32_t kId = 5;
+};
+
+template <>
+struct Array2DElement<std::complex<float>> {
+  static constexpr uint32_t kId = 6;
+};
+
+template <>
+struct Array2DElement<std::complex<double>> {
+  static constexpr uint32_t kId = 7;
+};
+
+namespace array2d_expression {
+
+// Base of the lazy expressions built by the operators at the end of this
+// file.
+struct Node {};
+
+template <class T>
+constexpr bool kIsNode = std::is_base_of_v<Node, T>;
+
+// Arrays, including classes derived from Array2D such as Image.
+template <class V>
+std::true_type isArray(const Array2D<V>*);
+std::false_type isArray(...);
+
+template <class T>
+constexpr bool kIsArray = decltype(isArray(std::declval<T*>()))::value;
+
+template <class T>
+constexpr bool kIsExpression = kIsArray<T> || kIsNode<T>;
+
+}  // namespace array2d_expression
+
 struct Shape {
   Shape(size_t width, size_t height) : width_(width), height_(height) {}
   size_t width_, height_;
@@ -19,20 +137,26 @@ class Array2D {
   template <class>
   friend class Array2D;
 
+  // Values per block of the element-wise operations.
+  static constexpr size_t kLanes = 8;
+  static constexpr size_t kAlignment = 64;
+
   // Ctors.
-  Array2D(size_t width, size_t height)
-      : width_(width), height_(height), size_(width * height) {
-    data_ = new value_type[size_]();
+  Array2D(size_t width, size_t height) : Array2D(width, height, width) {}
+
+  Array2D(size_t width, size_t height, size_t pitch)
+      : width_(width), height_(height), size_(width * height), pitch_(pitch) {
+    CHECK(pitch >= width) << "pitch " << pitch << " < width " << width;
+    allocate();
   }
 
   Array2D(const Shape& shape) : Array2D(shape.width_, shape.height_) {}
 
   template <class other_value_type>
   Array2D(const Array2D<other_value_type>& other)
-      : width_(other.width()), height_(other.height()), size_(other.size()) {
-    data_ = new value_type[size_];
-    for (int i = 0; i < size_; ++i) {
-      data_[i] = other.data_[i];
+      : Array2D(other.width(), other.height()) {
+    for (size_t y = 0; y < height_; ++y) {
+      std::copy_n(&other(0, y), width_, &(*this)(0, y));
     }
   }
 
@@ -40,17 +164,38 @@ class Array2D {
   Array2D<other_value_type> transform(
       const std::function<other_value_type(value_type)>& f) {
     Array2D<other_value_type> res(width(), height());
-    for (int i = 0; i < size_; ++i) {
-      res.data_[i] = f(data_[i]);
+    for (size_t y = 0; y < height_; ++y) {
+      std::transform(&(*this)(0, y), &(*this)(0, y) + width_, &res(0, y), f);
     }
     return res;
   }
 
+  // The smallest pitch >= width whose rows are whole cache lines and do not
+  // start a multiple of 4096 bytes apart. Otherwise, as with power of two
+  // widths, all the values of a column map to the same cache set (and loads
+  // alias stores 4K apart), which slows down column passes several times.
+  static size_t paddedPitch(size_t width) {
+    auto aligned = [](size_t pitch) {
+      return pitch * sizeof(value_type) % kAlignment == 0;
+    };
+    size_t pitch = std::max<size_t>(width, 1);
+    while (!aligned(pitch)) {
+      pitch++;
+    }
+    if (pitch * sizeof(value_type) % 4096 == 0) {
+      do {
+        pitch++;
+      } while (!aligned(pitch));
+    }
+    return pitch;
+  }
+
   Array2D(const std::initializer_list<std::initializer_list<value_type>>& lst) {
     height_ = lst.size();
     width_ = lst.begin()->size();
     size_ = width_ * height_;
-    data_ = new value_type[size_];
+    pitch_ = width_;
+    allocate();
     int i = 0;
     for (const auto& l : lst) {
       CHECK(l.size() == width_)
@@ -63,33 +208,54 @@ class Array2D {
   }
 
   Array2D(const Array2D<value_type>& other)
-      : width_(other.width()), height_(other.height()), size_(other.size()) {
-    data_ = new value_type[size_];
-    for (int i = 0; i < size_; ++i) {
-      data_[i] = other.data_[i];
-    }
+      : Array2D(other.width(), other.height(), other.pitch()) {
+    forEachRun(other, [](value_type* dst, const value_type* src, size_t n) {
+      std::copy_n(src, n, dst);
+    });
   }
 
   Array2D(Array2D<value_type>&& other) { *this = std::move(other); }
 
+  // Evaluates an expression such as (a + b) * 0.5f in a single pass.
+  template <class E,
+            std::enable_if_t<array2d_expression::kIsNode<E>, int> = 0>
+  Array2D(const E& expression)
+      : Array2D(expression.width(), expression.height()) {
+    assign(expression);
+  }
+
   Array2D& operator=(Array2D&& other) {
     if (this != &other) {
       std::swap(width_, other.width_);
       std::swap(height_, other.height_);
       std::swap(size_, other.size_);
+      std::swap(pitch_, other.pitch_);
       std::swap(data_, other.data_);
+      std::swap(mapping_, other.mapping_);
+    }
+    return *this;
+  }
+
+  // The expression may use this array, as values are only read at the
+  // position they are written to.
+  template <class E,
+            std::enable_if_t<array2d_expression::kIsNode<E>, int> = 0>
+  Array2D& operator=(const E& expression) {
+    if (width_ != expression.width() || height_ != expression.height()) {
+      return *this = Array2D(expression);
     }
+    assign(expression);
     return *this;
   }
 
   Array2D& fill(const value_type& v) {
-    std::fill_n(data_, size_, value_type{});
+    forEachRun([&v](value_type* p, size_t n) { std::fill_n(p, n, v); });
     return *this;
   }
   Array2D& operator=(const value_type& v) { return fill(v); }
   Array2D& clear() { return fill(value_type{}); }
 
-  ~Array2D() { delete[] data_; }
+  ~Array2D() { release(); }
 
   Shape shape() const { return Shape(width_, height_); }
 
@@ -112,12 +278,12 @@ class Array2D {
     if (width_ != other.width_ || height_ != other.height_) {
       return false;
     }
-    for (int i = 0; i < size_; ++i) {
-      if (data_[i] != other.data_[i]) {
-        return false;
-      }
-    }
-    return true;
+    bool equal = true;
+    forEachRun(other, [&equal](const value_type* a, const value_type* b,
+                               size_t n) {
+      equal = equal && std::equal(a, a + n, b);
+    });
+    return equal;
   }
 
   // Indexed access.
@@ -142,12 +308,12 @@ class Array2D {
   }
 
   value_type& at(int i) {
-    CHECK(is_safe(i)) << "unsafe access - i: " << i;
+    CHECK(is_safe(i) && contiguous()) << "unsafe access - i: " << i;
     return data_[i];
   }
 
   const value_type& at(int i) const {
-    CHECK(is_safe(i)) << "unsafe access - i: " << i;
+    CHECK(is_safe(i) && contiguous()) << "unsafe access - i: " << i;
     return data_[i];
   }
 
@@ -157,7 +323,7 @@ class Array2D {
   }
 
   ArrayView<value_type> column(int i) const {
-    return ArrayView<value_type>(data_ + index(i, 0), height_, width_);
+    return ArrayView<value_type>(data_ + index(i, 0), height_, pitch_);
   }
 
   // Both col and column work.
@@ -169,12 +335,17 @@ class Array2D {
   ArrayView<value_type> last_col() const { return col(width_ - 1); }
 
   ArrayView<value_type> flatten() const {
+    CHECK(contiguous()) << "flattening an array with padded rows";
     return ArrayView<value_type>(data_, size_, 1);
   }
 
   size_t width() const { return width_; }
   size_t height() const { return height_; }
   size_t size() const { return size_; }
+  // Values from the start of a row to the start of the next.
+  size_t pitch() const { return pitch_; }
+  // Whether rows follow each other without padding.
+  bool contiguous() const { return pitch_ == width_; }
 
   Array2D<value_type> rotate(int x_rotation, int y_rotation) {
     Array2D<value_type> res(width(), height());
@@ -202,10 +373,8 @@ class Array2D {
     Array2D<value_type> res(width, height);
     size_t w = std::min(width_, width);
     size_t h = std::min(height_, height);
-    for (int y = 0; y < h; ++y) {
-      for (int x = 0; x < w; ++x) {
-        res(x, y) = (*this)(x, y);
-      }
+    for (size_t y = 0; y < h; ++y) {
+      std::copy_n(&(*this)(0, y), w, &res(0, y));
     }
     return res;
   }
@@ -246,93 +415,239 @@ class Array2D {
     return ss.str();
   }
 
-  // Serialization.
+  // Serialization. Files start with kMagic, which is not a plausible width
+  // for the legacy files which start with theirs.
+  static constexpr char kMagic[8] = {'\x89', 'A', '2', 'D',
+                                     '\r',   '\n', '\x1a', '\n'};
+  static constexpr uint32_t kFileVersion = 1;
+
+  struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t element_id;
+    uint32_t element_size;
+    uint32_t reserved;
+    uint64_t width;
+    uint64_t height;
+    uint64_t pitch;
+    uint64_t checksum;
+    char padding[8];
+  };
+  static_assert(sizeof(FileHeader) == kAlignment);
+
   void serialize(const std::string& filename) const {
+    const size_t bytes = pitch_ * height_ * sizeof(value_type);
+    FileHeader header = {};
+    std::copy_n(kMagic, sizeof(kMagic), header.magic);
+    header.version = kFileVersion;
+    header.element_id = Array2DElement<value_type>::kId;
+    header.element_size = sizeof(value_type);
+    header.width = width_;
+    header.height = height_;
+    header.pitch = pitch_;
+    header.checksum = checksum(data_, bytes);
     std::ofstream file(filename, std::ofstream::binary);
-    file.write((char*)&width_, sizeof(width_));
-    file.write((char*)&height_, sizeof(height_));
-    file.write((char*)&size_, sizeof(size_));
-    file.write((char*)data_, sizeof(value_type) * size_);
+    file.write((char*)&header, sizeof(header));
+    file.write((char*)data_, bytes);
     file.close();
+    CHECK(file) << "can't write " << filename;
   }
 
-  void deserialize(const std::string& filename) const {
+  // Replaces the array with the one in the file, and checks its checksum.
+  void deserialize(const std::string& filename) {
     std::ifstream file(filename, std::ifstream::binary);
-    file.read((char*)&width_, sizeof(width_));
-    file.read((char*)&height_, sizeof(height_));
-    file.read((char*)&size_, sizeof(size_));
-    file.read((char*)data_, sizeof(value_type) * size_);
-    file.close();
+    CHECK(file) << "can't open " << filename;
+    FileHeader header = {};
+    file.read((char*)&header, sizeof(header));
+    if (!isHeader(header)) {
+      *this = readLegacy(filename);
+      return;
+    }
+    checkHeader(header, filename);
+    Array2D<value_type> res(header.width, header.height, header.pitch);
+    const size_t bytes = res.pitch_ * res.height_ * sizeof(value_type);
+    file.read((char*)res.data_, bytes);
+    CHECK(file) << filename << " is truncated";
+    CHECK(checksum(res.data_, bytes) == header.checksum)
+        << filename << " is corrupted";
+    *this = std::move(res);
   }
 
-  // Scalar operations.
-  template <class multiplier_type>
-  void operator*=(multiplier_type a) {
-    for (int i = 0; i < size(); ++i) {
-      data_[i] *= a;
+  // Like deserialize, but maps the file into memory rather than reading it:
+  // values are only read from disk when first accessed, and changes stay
+  // private to this array. The checksum is only verified if asked, as that
+  // reads the whole file. The file must not be rewritten while mapped.
+  void map(const std::string& filename, bool verify = false) {
+    static_assert(std::is_trivially_copyable_v<value_type>,
+                  "only arrays of plain values can be mapped");
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    CHECK(fd >= 0) << "can't open " << filename;
+    FileHeader header = {};
+    struct stat st = {};
+    if (::pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        !isHeader(header) || ::fstat(fd, &st) != 0) {
+      ::close(fd);
+      deserialize(filename);
+      return;
+    }
+    checkHeader(header, filename);
+    const size_t length =
+        sizeof(header) + header.pitch * header.height * sizeof(value_type);
+    CHECK(size_t(st.st_size) >= length) << filename << " is truncated";
+    void* p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                     0);
+    ::close(fd);
+    CHECK(p != MAP_FAILED) << "can't map " << filename;
+
+    release();
+    mapping_ = std::shared_ptr<void>(
+        p, [length](void* p) { ::munmap(p, length); });
+    data_ = reinterpret_cast<value_type*>(static_cast<char*>(p) +
+                                          sizeof(header));
+    width_ = header.width;
+    height_ = header.height;
+    size_ = width_ * height_;
+    pitch_ = header.pitch;
+    if (verify) {
+      CHECK(checksum(data_, length - sizeof(header)) == header.checksum)
+          << filename << " is corrupted";
     }
-  }
-  template <class multiplier_type>
-  Array2D<value_type> operator*(multiplier_type a) {
-    Array2D<value_type> res = *this;
-    res *= a;
-    return res;
   }
 
-  void operator*=(const Array2D<value_type>& other) {
-    for (int i = 0; i < size(); ++i) {
-      data_[i] *= other.data_[i];
+  // Reads the dimensions of the array in the file, if it holds one which
+  // deserialize and map can read.
+  static bool readDimensions(const std::string& filename, size_t* width,
+                             size_t* height) {
+    std::ifstream file(filename, std::ifstream::binary);
+    FileHeader header = {};
+    file.read((char*)&header, sizeof(header));
+    std::error_code error;
+    const uintmax_t bytes = std::filesystem::file_size(filename, error);
+    if (error) {
+      return false;
+    }
+    if (file && isHeader(header)) {
+      if (header.version != kFileVersion ||
+          header.element_size != sizeof(value_type) ||
+          header.element_id != Array2DElement<value_type>::kId ||
+          header.pitch < header.width ||
+          bytes < sizeof(header) +
+                      header.pitch * header.height * sizeof(value_type)) {
+        return false;
+      }
+      *width = header.width;
+      *height = header.height;
+      return true;
+    }
+    size_t legacy[3];
+    std::memcpy(legacy, &header, sizeof(legacy));
+    if (bytes < sizeof(legacy) || legacy[2] != legacy[0] * legacy[1] ||
+        bytes != sizeof(legacy) + legacy[2] * sizeof(value_type)) {
+      return false;
     }
+    *width = legacy[0];
+    *height = legacy[1];
+    return true;
   }
 
-  template <class divisor>
-  void operator/=(divisor a) {
-    for (int i = 0; i < size(); ++i) {
-      data_[i] /= a;
+  // Fletcher-like checksum of the bytes, 8 at a time.
+  static uint64_t checksum(const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    uint64_t a = 0;
+    uint64_t b = 0;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)) {
+      uint64_t word;
+      std::memcpy(&word, p + i, sizeof(word));
+      a += word;
+      b += a;
     }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p + i, bytes - i);
+    a += tail;
+    b += a;
+    return a ^ (b << 1 | b >> 63);
   }
-  template <class divisor>
-  Array2D<value_type> operator/(divisor a) {
-    Array2D<value_type> res = *this;
-    res /= a;
-    return res;
+
+  // Scalar operations.
+  template <class multiplier_type>
+  void operator*=(multiplier_type a) {
+    forEachBlock([a](value_type* p, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        p[i] *= a;
+      }
+    });
+  }
+  void operator*=(const Array2D<value_type>& other) {
+    forEachBlock(other, [](value_type* p, const value_type* q, size_t n) {
+      value_type block[kLanes];
+      std::copy_n(q, n, block);
+      for (size_t i = 0; i < n; ++i) {
+        p[i] *= block[i];
+      }
+    });
   }
 
+  template <class divisor>
+  void operator/=(divisor a) {
+    forEachBlock([a](value_type* p, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        p[i] /= a;
+      }
+    });
+  }
+  // Sums kLanes interleaved partial sums, which is also more accurate than a
+  // single running sum.
   value_type sum() const {
+    value_type sums[kLanes] = {};
+    forEachBlock([&sums](const value_type* p, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        sums[i] += p[i];
+      }
+    });
     value_type sum = 0;
-    for (int i = 0; i < size(); ++i) {
-      sum += data_[i];
+    for (const value_type& s : sums) {
+      sum += s;
     }
     return sum;
   }
 
   value_type min() const {
-    const auto flat = flatten();
-    return *std::min_element(flat.cbegin(), flat.cend());
+    value_type mins[kLanes];
+    std::fill_n(mins, kLanes, data_[0]);
+    forEachBlock([&mins](const value_type* p, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        mins[i] = std::min(mins[i], p[i]);
+      }
+    });
+    return *std::min_element(mins, mins + kLanes);
   }
 
   value_type max() const {
-    const auto flat = flatten();
-    return *std::max_element(flat.cbegin(), flat.cend());
+    value_type maxs[kLanes];
+    std::fill_n(maxs, kLanes, data_[0]);
+    forEachBlock([&maxs](const value_type* p, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        maxs[i] = std::max(maxs[i], p[i]);
+      }
+    });
+    return *std::max_element(maxs, maxs + kLanes);
   }
 
   void operator+=(const Array2D<value_type>& other) {
-    for (int i = 0; i < size(); ++i) {
-      data_[i] += other.data_[i];
-    }
-  }
-
-  Array2D<value_type> operator+(const Array2D<value_type>& other) const {
-    Array2D<value_type> res = *this;
-    res += other;
-    return res;
+    forEachBlock(other, [](value_type* p, const value_type* q, size_t n) {
+      value_type block[kLanes];
+      std::copy_n(q, n, block);
+      for (size_t i = 0; i < n; ++i) {
+        p[i] += block[i];
+      }
+    });
   }
 
   void inormalize() { (*this) /= sum(); }
 
   void iaverage(const Array2D<value_type>& other) {
-    (*this) += other;
-    (*this) /= 2;
+    *this = (*this + other) / 2;
   }
 
   bool is_safe(int x, int y) const {
@@ -342,12 +657,152 @@ class Array2D {
   bool is_safe(int i) const { return i >= 0 && i < size_; }
 
  protected:
-  inline int index(int x, int y) const { return (y * width_) + x; }
+  inline size_t index(int x, int y) const { return y * pitch_ + x; }
+
+  // Calls f(p, n) on runs of n values which together cover the array, in
+  // order: the whole array at once when it is contiguous, else each row.
+  template <class F>
+  void forEachRun(const F& f) const {
+    if (contiguous()) {
+      f(data_, size_);
+      return;
+    }
+    for (size_t y = 0; y < height_; ++y) {
+      f(data_ + y * pitch_, width_);
+    }
+  }
+
+  // Same, with the matching runs of another array of the same dimensions.
+  template <class other_value_type, class F>
+  void forEachRun(const Array2D<other_value_type>& other, const F& f) const {
+    CHECK(width_ == other.width() && height_ == other.height())
+        << "arrays of different sizes: " << width_ << 'x' << height_ << " and "
+        << other.width() << 'x' << other.height();
+    if (contiguous() && other.contiguous()) {
+      f(data_, other.data_, size_);
+      return;
+    }
+    for (size_t y = 0; y < height_; ++y) {
+      f(data_ + y * pitch_, other.data_ + y * other.pitch_, width_);
+    }
+  }
+
+  // Like forEachRun, but on blocks of kLanes values, then on the shorter ends
+  // of runs. Once f is inlined, its loops over full blocks have a constant
+  // length, which the compiler vectorizes even at -O2.
+  template <class F>
+  void forEachBlock(const F& f) const {
+    forEachRun([&f](value_type* p, size_t n) {
+      size_t i = 0;
+      for (; i + kLanes <= n; i += kLanes) {
+        f(p + i, kLanes);
+      }
+      f(p + i, n - i);
+    });
+  }
+
+  template <class other_value_type, class F>
+  void forEachBlock(const Array2D<other_value_type>& other, const F& f) const {
+    forEachRun(other, [&f](value_type* p, const other_value_type* q, size_t n) {
+      size_t i = 0;
+      for (; i + kLanes <= n; i += kLanes) {
+        f(p + i, q + i, kLanes);
+      }
+      f(p + i, q + i, n - i);
+    });
+  }
+
+  // Evaluates the rows of an expression of the same dimensions, one block of
+  // kLanes values at a time (see forEachBlock).
+  template <class E>
+  void assign(const E& expression) {
+    if (expression.hasKept()) {
+      assignRows<true>(expression);
+    } else {
+      assignRows<false>(expression);
+    }
+  }
+
+  template <bool kCheckKept, class E>
+  void assignRows(const E& expression) {
+    for (size_t y = 0; y < height_; ++y) {
+      value_type* p = data_ + y * pitch_;
+      const auto row = expression.template row<kCheckKept>(y);
+      size_t x = 0;
+      for (; x + kLanes <= width_; x += kLanes) {
+        value_type block[kLanes];
+        for (size_t i = 0; i < kLanes; ++i) {
+          block[i] = row[x + i];
+        }
+        std::copy_n(block, kLanes, p + x);
+      }
+      for (; x < width_; ++x) {
+        p[x] = row[x];
+      }
+    }
+  }
+
+  static bool isHeader(const FileHeader& header) {
+    return std::equal(kMagic, kMagic + sizeof(kMagic), header.magic);
+  }
+
+  static void checkHeader(const FileHeader& header,
+                          const std::string& filename) {
+    CHECK(header.version == kFileVersion)
+        << filename << " has version " << header.version << ", not "
+        << kFileVersion;
+    CHECK(header.element_size == sizeof(value_type) &&
+          header.element_id == Array2DElement<value_type>::kId)
+        << filename << " holds values of type " << header.element_id
+        << " and size " << header.element_size << ", not "
+        << Array2DElement<value_type>::kId << " and " << sizeof(value_type);
+    CHECK(header.pitch >= header.width)
+        << filename << " has pitch " << header.pitch << " < width "
+        << header.width;
+  }
+
+  // Files written before FileHeader: width, height and size as size_t, then
+  // the values.
+  static Array2D<value_type> readLegacy(const std::string& filename) {
+    std::ifstream file(filename, std::ifstream::binary);
+    size_t dimensions[3] = {};
+    file.read((char*)dimensions, sizeof(dimensions));
+    CHECK(file && dimensions[2] == dimensions[0] * dimensions[1])
+        << filename << " is not an array file";
+    Array2D<value_type> res(dimensions[0], dimensions[1]);
+    file.read((char*)res.data_, res.size_ * sizeof(value_type));
+    CHECK(file) << filename << " is truncated";
+    return res;
+  }
+
+  void allocate() {
+    const size_t count = pitch_ * height_;
+    data_ = static_cast<value_type*>(::operator new(
+        std::max<size_t>(count, 1) * sizeof(value_type),
+        std::align_val_t(kAlignment)));
+    std::uninitialized_value_construct_n(data_, count);
+  }
+
+  void release() {
+    if (mapping_) {
+      mapping_.reset();
+      data_ = 0;
+      return;
+    }
+    if (data_ != 0) {
+      std::destroy_n(data_, pitch_ * height_);
+      ::operator delete(data_, std::align_val_t(kAlignment));
+      data_ = 0;
+    }
+  }
 
   size_t width_ = 0;
   size_t height_ = 0;
   size_t size_ = 0;
+  size_t pitch_ = 0;
   value_type* data_ = 0;
+  // Keeps the file data_ points to mapped, for arrays built by map.
+  std::shared_ptr<void> mapping_;
 };
 
 template <class value_type>
@@ -355,4 +810,254 @@ std::ostream& operator<<(std::ostream& os, Array2D<value_type> const& arr) {
   return os << arr.str();
 }
 
+namespace array2d_expression {
+
+// Expressions hold arrays by reference and other expressions by value.
+template <class V>
+const Array2D<V>& operand(const Array2D<V>& arr);
+template <class N, std::enable_if_t<kIsNode<N>, int> = 0>
+N operand(const N& node);
+
+template <class T>
+using Operand = decltype(operand(std::declval<const T&>()));
+
+template <class V>
+V value(const Array2D<V>& arr);
+template <class N, std::enable_if_t<kIsNode<N>, int> = 0>
+typename N::value_type value(const N& node);
+
+template <class T>
+using Value = decltype(value(std::declval<const T&>()));
+
+// Row y of an expression, whose values are row[x]. Rows only look for kept
+// values (see Expression) if kCheckKept, which keeps the check out of the
+// loops over expressions which have none.
+template <bool kCheckKept, class V>
+const V* row(const Array2D<V>& arr, size_t y) {
+  return &arr(0, y);
+}
+
+template <bool kCheckKept, class N, std::enable_if_t<kIsNode<N>, int> = 0>
+typename N::template Row<kCheckKept> row(const N& node, size_t y) {
+  return node.template row<kCheckKept>(y);
+}
+
+template <class T, bool kCheckKept>
+using Row = decltype(row<kCheckKept>(std::declval<Operand<T>>(), 0));
+
+// Whether the expression or one of its operands has kept values.
+template <class V>
+bool hasKept(const Array2D<V>&) {
+  return false;
+}
+
+template <class N, std::enable_if_t<kIsNode<N>, int> = 0>
+bool hasKept(const N& node) {
+  return node.hasKept();
+}
+
+struct Add {
+  template <class A, class B>
+  void operator()(A& a, const B& b) const {
+    a += b;
+  }
+};
+
+struct Multiply {
+  template <class A, class B>
+  void operator()(A& a, const B& b) const {
+    a *= b;
+  }
+};
+
+struct Divide {
+  template <class A, class B>
+  void operator()(A& a, const B& b) const {
+    a /= b;
+  }
+};
+
+// The members shared by expressions, which behave as arrays of value type V.
+// Once computed (see the top of this file), rows return the kept values.
+template <class Derived, class V>
+class Expression : public Node {
+ public:
+  typedef V value_type;
+
+  Expression() {}
+  Expression(const Expression& other) { *this = other; }
+  Expression(Expression&& other) = default;
+  Expression& operator=(const Expression& other) {
+    values_ = other.values_ ? std::make_unique<Array2D<V>>(*other.values_)
+                            : nullptr;
+    return *this;
+  }
+  Expression& operator=(Expression&& other) = default;
+
+  Array2D<V> eval() const { return Array2D<V>(derived()); }
+
+  V sum() const { return values().sum(); }
+  V min() const { return values().min(); }
+  V max() const { return values().max(); }
+  size_t size() const { return derived().width() * derived().height(); }
+
+  bool kept() const { return values_ != nullptr; }
+
+  V& operator()(int x, int y) { return values()(x, y); }
+  const V& operator()(int x, int y) const { return values()(x, y); }
+  V& operator()(int i) { return values()(i); }
+  const V& operator()(int i) const { return values()(i); }
+
+ protected:
+  // Row y of the kept values, or 0 if the expression was not computed.
+  const V* keptRow(size_t y) const {
+    return values_ ? &(*values_)(0, y) : nullptr;
+  }
+
+ private:
+  const Derived& derived() const { return static_cast<const Derived&>(*this); }
+
+  Array2D<V>& values() const {
+    if (!values_) {
+      values_ = std::make_unique<Array2D<V>>(derived());
+    }
+    return *values_;
+  }
+
+  mutable std::unique_ptr<Array2D<V>> values_;
+};
+
+// op(l, r) at each position, computed as l op= r so that values round as
+// with the compound assignments of Array2D.
+template <class L, class R, class Op>
+class Elementwise : public Expression<Elementwise<L, R, Op>, Value<L>> {
+ public:
+  typedef Value<L> value_type;
+
+  Elementwise(const L& l, const R& r) : l_(l), r_(r) {
+    CHECK(l.width() == r.width() && l.height() == r.height())
+        << "arrays of different sizes: " << l.width() << 'x' << l.height()
+        << " and " << r.width() << 'x' << r.height();
+  }
+
+  size_t width() const { return l_.width(); }
+  size_t height() const { return l_.height(); }
+
+  template <bool kCheckKept>
+  struct Row {
+    const value_type* kept;
+    array2d_expression::Row<L, kCheckKept> l;
+    array2d_expression::Row<R, kCheckKept> r;
+
+    value_type operator[](size_t x) const {
+      if constexpr (kCheckKept) {
+        if (kept) {
+          return kept[x];
+        }
+      }
+      value_type v = l[x];
+      Op()(v, r[x]);
+      return v;
+    }
+  };
+
+  template <bool kCheckKept>
+  Row<kCheckKept> row(size_t y) const {
+    return {this->keptRow(y), array2d_expression::row<kCheckKept>(l_, y),
+            array2d_expression::row<kCheckKept>(r_, y)};
+  }
+
+  bool hasKept() const {
+    return this->kept() || array2d_expression::hasKept(l_) ||
+           array2d_expression::hasKept(r_);
+  }
+
+ private:
+  Operand<L> l_;
+  Operand<R> r_;
+};
+
+// op(e, scalar) at each position.
+template <class E, class S, class Op>
+class Scalar : public Expression<Scalar<E, S, Op>, Value<E>> {
+ public:
+  typedef Value<E> value_type;
+
+  Scalar(const E& e, const S& scalar) : e_(e), scalar_(scalar) {}
+
+  size_t width() const { return e_.width(); }
+  size_t height() const { return e_.height(); }
+
+  template <bool kCheckKept>
+  struct Row {
+    const value_type* kept;
+    array2d_expression::Row<E, kCheckKept> e;
+    S scalar;
+
+    value_type operator[](size_t x) const {
+      if constexpr (kCheckKept) {
+        if (kept) {
+          return kept[x];
+        }
+      }
+      value_type v = e[x];
+      Op()(v, scalar);
+      return v;
+    }
+  };
+
+  template <bool kCheckKept>
+  Row<kCheckKept> row(size_t y) const {
+    return {this->keptRow(y), array2d_expression::row<kCheckKept>(e_, y),
+            scalar_};
+  }
+
+  bool hasKept() const {
+    return this->kept() || array2d_expression::hasKept(e_);
+  }
+
+ private:
+  Operand<E> e_;
+  S scalar_;
+};
+
+}  // namespace array2d_expression
+
+template <class L, class R,
+          std::enable_if_t<array2d_expression::kIsExpression<L> &&
+                               array2d_expression::kIsExpression<R>,
+                           int> = 0>
+array2d_expression::Elementwise<L, R, array2d_expression::Add> operator+(
+    const L& l, const R& r) {
+  return {l, r};
+}
+
+// Element-wise product.
+template <class L, class R,
+          std::enable_if_t<array2d_expression::kIsExpression<L> &&
+                               array2d_expression::kIsExpression<R>,
+                           int> = 0>
+array2d_expression::Elementwise<L, R, array2d_expression::Multiply> operator*(
+    const L& l, const R& r) {
+  return {l, r};
+}
+
+template <class E, class S,
+          std::enable_if_t<array2d_expression::kIsExpression<E> &&
+                               !array2d_expression::kIsExpression<S>,
+                           int> = 0>
+array2d_expression::Scalar<E, S, array2d_expression::Multiply> operator*(
+    const E& e, const S& scalar) {
+  return {e, scalar};
+}
+
+template <class E, class S,
+          std::enable_if_t<array2d_expression::kIsExpression<E> &&
+                               !array2d_expression::kIsExpression<S>,
+                           int> = 0>
+array2d_expression::Scalar<E, S, array2d_expression::Divide> operator/(
+    const E& e, const S& scalar) {
+  return {e, scalar};
+}
+
 #endif
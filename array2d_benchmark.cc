@@ -0,0 +1,152 @@
+// Times the element-wise operations and expressions of Array2D against plain
+// loops over the same values, on contiguous arrays and arrays with padded
+// rows.
+// Usage: array2d_benchmark [--size=2048] [--repeat=20]
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "array2d.h"
+
+ABSL_FLAG(int, size, 2048, "Width and height of the arrays");
+ABSL_FLAG(int, repeat, 20, "Number of runs");
+
+// Returns the time per run in milliseconds.
+template <class F>
+double benchmark(const F& f) {
+  int repeat = absl::GetFlag(FLAGS_repeat);
+  f();  // Warm up.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / repeat;
+}
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const int n = absl::GetFlag(FLAGS_size);
+  Array2D<float> arr(n, n);
+  Array2D<float> other(n, n);
+  Array2D<float> padded(n, n, Array2D<float>::paddedPitch(n));
+  Array2D<float> padded_other(n, n, Array2D<float>::paddedPitch(n));
+  Array2D<float> res(n, n);
+  Array2D<float> padded_res(n, n, Array2D<float>::paddedPitch(n));
+  std::vector<float> flat(size_t(n) * n);
+  std::vector<float> flat_other(size_t(n) * n);
+  std::vector<float> flat_res(size_t(n) * n);
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      float v = (x * 7 + y * 3) % 11 * 0.1f;
+      arr(x, y) = padded(x, y) = flat[size_t(y) * n + x] = v;
+      other(x, y) = padded_other(x, y) = flat_other[size_t(y) * n + x] = 1;
+    }
+  }
+
+  // Results are accumulated here, so that no loop is optimized away.
+  float sum = 0;
+  // Changes a value before each min and max, which could otherwise be hoisted
+  // out of the runs.
+  int run = 0;
+  auto report = [](const char* name, double flat_ms, double arr_ms,
+                   double padded_ms) {
+    std::cout << name << ", ms: loop " << flat_ms << ", Array2D " << arr_ms
+              << ", padded " << padded_ms << std::endl;
+  };
+
+  report(
+      "+=",
+      benchmark([&]() {
+        for (size_t i = 0; i < flat.size(); ++i) {
+          flat[i] += flat_other[i];
+        }
+      }),
+      benchmark([&]() { arr += other; }),
+      benchmark([&]() { padded += padded_other; }));
+  report(
+      "*=",
+      benchmark([&]() {
+        for (float& v : flat) {
+          v *= 0.999f;
+        }
+      }),
+      benchmark([&]() { arr *= 0.999f; }),
+      benchmark([&]() { padded *= 0.999f; }));
+  report(
+      "/=",
+      benchmark([&]() {
+        for (float& v : flat) {
+          v /= 1.001f;
+        }
+      }),
+      benchmark([&]() { arr /= 1.001f; }),
+      benchmark([&]() { padded /= 1.001f; }));
+  report(
+      "sum",
+      benchmark([&]() {
+        float s = 0;
+        for (float v : flat) {
+          s += v;
+        }
+        sum += s;
+      }),
+      benchmark([&]() { sum += arr.sum(); }),
+      benchmark([&]() { sum += padded.sum(); }));
+  report(
+      "min",
+      benchmark([&]() {
+        flat[0] = run++ % 2;
+        sum += *std::min_element(flat.begin(), flat.end());
+      }),
+      benchmark([&]() {
+        arr(0) = run++ % 2;
+        sum += arr.min();
+      }),
+      benchmark([&]() {
+        padded(0, 0) = run++ % 2;
+        sum += padded.min();
+      }));
+  report(
+      "max",
+      benchmark([&]() {
+        flat[0] = run++ % 2;
+        sum += *std::max_element(flat.begin(), flat.end());
+      }),
+      benchmark([&]() {
+        arr(0) = run++ % 2;
+        sum += arr.max();
+      }),
+      benchmark([&]() {
+        padded(0, 0) = run++ % 2;
+        sum += padded.max();
+      }));
+  report(
+      "(a + b) * 0.5f",
+      benchmark([&]() {
+        for (size_t i = 0; i < flat.size(); ++i) {
+          flat_res[i] = (flat[i] + flat_other[i]) * 0.5f;
+        }
+      }),
+      benchmark([&]() { res = (arr + other) * 0.5f; }),
+      benchmark([&]() { padded_res = (padded + padded_other) * 0.5f; }));
+  // As the operators did before they returned expressions.
+  std::cout << "(a + b) * 0.5f with a temporary array, ms: "
+            << benchmark([&]() {
+                 Array2D<float> tmp(arr);
+                 tmp += other;
+                 tmp *= 0.5f;
+                 res = std::move(tmp);
+               })
+            << std::endl;
+
+  std::cout << "checksum: " << sum + flat[n] + arr(n) + padded(0, 1) + flat_res[n] + res(n) +
+                   padded_res(0, 1)
+            << std::endl;
+  return 0;
+}
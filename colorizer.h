@@ -1,9 +1,14 @@
 #ifndef COLORIZER_H
 #define COLORIZER_H
 
+#include <memory>
+
 #include "range.h"
-#include "perlin_noise.h"
+#include "noise.h"
+#include "noise_texture.h"
 #include "color.h"
+#include "footprint.h"
+#include "logging.h"
 #include "palette.h"
 
 class Colorizer {
@@ -52,25 +57,54 @@ private:
 
 class PerlinNoiseColorizer : public Colorizer {
 public:
-  PerlinNoiseColorizer(const Color& color1, const Color& color2, float scale)
-    : palette(color1, color2), scale(scale), surface(0) {}
+  PerlinNoiseColorizer(const Color& color1, const Color& color2, float scale,
+                       int octaves = 1,
+                       Noise::Type noise_type = Noise::PERLIN)
+    : palette(color1, color2), scale(scale), octaves(octaves), surface(0),
+      noise(Noise::get(noise_type)) {}
+
+  PerlinNoiseColorizer(std::initializer_list<Color> colors, float scale,
+                       int octaves = 1,
+                       Noise::Type noise_type = Noise::PERLIN)
+    : palette(colors), scale(scale), octaves(octaves), surface(0),
+      noise(Noise::get(noise_type)) {}
 
-  PerlinNoiseColorizer(std::initializer_list<Color> colors, float scale)
-    : palette(colors), scale(scale), surface(0) {}
+  PerlinNoiseColorizer(const Palette& palette, float scale, int octaves = 1,
+                       Noise::Type noise_type = Noise::PERLIN)
+    : palette(palette), scale(scale), octaves(octaves), surface(0),
+      noise(Noise::get(noise_type)) {}
 
   void setSurface(const ParametrizableSurface* surface) {
     this->surface = surface;
   }
 
+  // Samples a baked tileable noise texture instead of computing the noise,
+  // and maps it to colors with a compiled palette. The pattern then repeats
+  // every params.period noise cells.
+  void bake(const NoiseTexture::Params& params) {
+    CHECK(noise == Noise::get(Noise::PERLIN))
+        << "only perlin noise can be baked";
+    texture.reset(new NoiseTexture(PerlinNoise(), params));
+    noise = texture.get();
+    palette.compile();
+  }
+
+  const NoiseTexture* baked() const {
+    return texture.get();
+  }
+
   Color color(const vec3& v) const {
-    float alpha = perlin.noise(v.x * scale, v.y * scale, v.z * scale);
+    float alpha = noise->fbm(v.x * scale, v.y * scale, v.z * scale, octaves,
+                             Noise::detail(footprint::get() * scale, octaves));
     return palette.color(alpha);
   }
 private:
   Palette palette;
   float scale;
+  int octaves;
   const ParametrizableSurface* surface;
-  PerlinNoise perlin;
+  const Noise* noise;
+  std::unique_ptr<NoiseTexture> texture;
 };
 
 #endif
@@ -0,0 +1,100 @@
+// Times the ways filters::Convolve can run a filter, to tune the costs in
+// filters.h, and checks which one it picks.
+// Usage: convolution_benchmark [--max_size=1024] [--max_radius=16] [--repeat=3]
+//
+// Filters are triangles of radius 1, 2, 4... which are separable and have
+// (2 radius + 1)^2 taps, on square images of 256, 512... pixels. Each method
+// prints its time and nanoseconds per unit of work (see PlanConvolution), and
+// the medians are the values for kFFTCost, kSeparableCost and kDirectCost.
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "filters.h"
+#include "image.h"
+
+ABSL_FLAG(int, max_size, 1024, "Largest image size, starting from 256");
+ABSL_FLAG(int, max_radius, 16, "Largest filter radius, starting from 1");
+ABSL_FLAG(int, repeat, 3, "Number of runs");
+
+// Returns the time per run in milliseconds.
+template <class F>
+double benchmark(const F& f) {
+  int repeat = absl::GetFlag(FLAGS_repeat);
+  f();  // Warm up.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / repeat;
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  std::vector<double> fft_costs, separable_costs, direct_costs;
+  float sum = 0;
+  for (int n = 256; n <= absl::GetFlag(FLAGS_max_size); n *= 2) {
+    Image image(n, n);
+    for (int i = 0; i < image.size(); ++i) {
+      image(i) = Color(i % 7, i % 3, i % 5);
+    }
+    const double pixels = double(n) * n;
+
+    for (int radius = 1; radius <= absl::GetFlag(FLAGS_max_radius);
+         radius *= 2) {
+      ComplexArray2D filter(n, n);
+      std::vector<std::tuple<int, int, float>> taps;
+      const float total = pow(radius + 1, 4);
+      for (int dy = -radius; dy <= radius; ++dy) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+          float weight =
+              (radius + 1 - std::abs(dx)) * (radius + 1 - std::abs(dy)) / total;
+          filter((dx + n) % n, (dy + n) % n) = weight;
+          taps.emplace_back(dx, dy, weight);
+        }
+      }
+      filters::ConvolutionPlan plan = filters::PlanConvolution(filter);
+
+      double fft_ms = benchmark([&]() { filters::ConvolveFFT(image, filter); });
+      double separable_ms = benchmark(
+          [&]() { filters::ConvolveSeparable(image, plan.row, plan.column); });
+      double direct_ms =
+          benchmark([&]() { filters::ConvolveDirect(image, taps); });
+      double convolve_ms =
+          benchmark([&]() { filters::Convolve(image, filter); });
+      sum += image(n / 2).r;
+
+      fft_costs.push_back(fft_ms * 1e6 / (pixels * log2(pixels)));
+      separable_costs.push_back(
+          separable_ms * 1e6 / (pixels * (plan.row.size() + plan.column.size())));
+      direct_costs.push_back(direct_ms * 1e6 / (pixels * taps.size()));
+      const char* methods[] = {"fft", "separable", "direct"};
+      std::cout << n << 'x' << n << ", radius " << radius << ", ms: fft "
+                << fft_ms << ", separable " << separable_ms << ", direct "
+                << direct_ms << ", Convolve (" << methods[plan.method] << ") "
+                << convolve_ms << "; ns per unit: fft " << fft_costs.back()
+                << ", separable " << separable_costs.back() << ", direct "
+                << direct_costs.back() << std::endl;
+    }
+  }
+  std::cout << "kFFTCost = " << median(fft_costs)
+            << ", kSeparableCost = " << median(separable_costs)
+            << ", kDirectCost = " << median(direct_costs) << std::endl;
+  // Keeps the results alive.
+  std::cout << "checksum: " << sum << std::endl;
+  return 0;
+}
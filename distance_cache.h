@@ -0,0 +1,266 @@
+/***
+ * Sparse distance field cache (brick map) for expensive static SDFs.
+ * Usage:
+ * #include "distance_cache.h"
+ * DistanceCache::Params params;
+ * params.voxel_size = 0.1;
+ * params.lipschitz = 1.3;
+ * SDF* planet = scene->make<DistanceCache>(deformed_sphere, params);
+ *
+ * The child's bounding box is split into bricks of brick_size^3 voxels. The
+ * distance is sampled at every brick corner (the coarse far field), and bricks
+ * near the surface additionally store samples at every voxel corner. Lookups
+ * interpolate trilinearly and subtract the largest possible interpolation
+ * error, so the cached distance never overshoots. Once it drops to
+ * exact_distance the child is evaluated instead, so the last few marching
+ * steps, hits and normals use the exact SDF.
+ *
+ * Bricks get voxels if the surface may be within narrow_band of them, plus
+ * however far coarse lookups may undershoot, so that coarse lookups stay above
+ * exact_distance and the child is only evaluated inside fine bricks. The
+ * grid extends past the child's bounds by at least as much.
+ *
+ * The child must be bounded and its distance must change by at most
+ * `lipschitz` per unit of length (1 for exact SDFs). If the bricks do not fit
+ * in max_bytes, voxel_size is doubled until they do.
+ ***/
+
+#ifndef DISTANCE_CACHE_H
+#define DISTANCE_CACHE_H
+
+#include <math.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "aabb.h"
+#include "counters.h"
+#include "logging.h"
+#include "sdf.h"
+#include "vec3.h"
+
+class DistanceCache : public SDF {
+ public:
+  struct Params {
+    float voxel_size = 0.1;
+    int brick_size = 8;
+    float narrow_band = 0.5;
+    float exact_distance = 0.1;
+    float lipschitz = 1;
+    size_t max_bytes = 16 << 20;
+  };
+
+  DistanceCache(SDF* child, const Params& params)
+      : child_(child), params_(params) {
+    CHECK(child->bounds().isFinite())
+        << "distance cache of an unbounded SDF";
+    CHECK(params.brick_size > 0 && params.voxel_size > 0)
+        << "invalid distance cache resolution";
+    while (!bake()) {
+      params_.voxel_size *= 2;
+    }
+  }
+
+  SDFResult sdf(const vec3& v) const {
+    SDF_COUNTERS(distance_cache);
+    float dist = cachedDistance(v);
+    if (dist > params_.exact_distance) {
+      return SDFResult(dist, Material());
+    }
+    DEFINE_COUNTER(distance_cache_exact_sdf_calls);
+    COUNTER_INC(distance_cache_exact_sdf_calls);
+    return child_->sdf(v);
+  }
+
+  // A lower bound on the child's distance at v.
+  float cachedDistance(const vec3& v) const {
+    if (box_.distance(v) > 0) {
+      // At least the band away from the child, as in BoxBound.
+      return child_box_.distance(v);
+    }
+    vec3 p = (v - box_.min) / brick_world_size_;
+    int bx = std::clamp(int(p.x), 0, nx_ - 1);
+    int by = std::clamp(int(p.y), 0, ny_ - 1);
+    int bz = std::clamp(int(p.z), 0, nz_ - 1);
+    vec3 local = p - vec3(bx, by, bz);
+    int brick = brick_index_[(bz * ny_ + by) * nx_ + bx];
+    if (brick < 0) {
+      return trilinear(coarse_.data(), nx_ + 1, ny_ + 1, bx, by, bz, local) -
+             coarse_error_;
+    }
+    int n = params_.brick_size;
+    local *= n;
+    int fx = std::min(int(local.x), n - 1);
+    int fy = std::min(int(local.y), n - 1);
+    int fz = std::min(int(local.z), n - 1);
+    const float* samples = &bricks_[size_t(brick) * brickSamples()];
+    return trilinear(samples, n + 1, n + 1, fx, fy, fz,
+                     local - vec3(fx, fy, fz)) -
+           fine_error_;
+  }
+
+  AABB bounds() const {
+    return child_->bounds();
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child_ = f(child_);
+  }
+
+  const Params& params() const {
+    return params_;
+  }
+
+  size_t numBricks() const {
+    return bricks_.size() / brickSamples();
+  }
+
+  size_t bytes() const {
+    return coarse_.size() * sizeof(float) + brick_index_.size() * sizeof(int) +
+           bricks_.size() * sizeof(float);
+  }
+
+  std::string str() const {
+    std::stringstream res;
+    res << "DistanceCache: " << nx_ << 'x' << ny_ << 'x' << nz_ << " bricks, "
+        << numBricks() << " fine bricks of " << params_.brick_size
+        << "^3 voxels of size " << params_.voxel_size << ", " << bytes()
+        << " bytes";
+    return res.str();
+  }
+
+ private:
+  size_t brickSamples() const {
+    size_t n = params_.brick_size + 1;
+    return n * n * n;
+  }
+
+  // Trilinear interpolation in a grid with row length sx and sy rows per
+  // slice, inside the cell whose lowest corner is (x, y, z).
+  static float trilinear(const float* grid, int sx, int sy, int x, int y,
+                         int z, const vec3& t) {
+    const float* c = grid + (size_t(z) * sy + y) * sx + x;
+    size_t dz = size_t(sx) * sy;
+    float c00 = c[0] + (c[1] - c[0]) * t.x;
+    float c10 = c[sx] + (c[sx + 1] - c[sx]) * t.x;
+    float c01 = c[dz] + (c[dz + 1] - c[dz]) * t.x;
+    float c11 = c[dz + sx] + (c[dz + sx + 1] - c[dz + sx]) * t.x;
+    float c0 = c00 + (c10 - c00) * t.y;
+    float c1 = c01 + (c11 - c01) * t.y;
+    return c0 + (c1 - c0) * t.z;
+  }
+
+  // Samples the child at the current resolution. Returns false if the result
+  // does not fit in the memory budget.
+  bool bake() {
+    const float lipschitz = params_.lipschitz;
+    const int n = params_.brick_size;
+    brick_world_size_ = params_.voxel_size * n;
+    // Trilinear interpolation of a function which changes by at most L per
+    // unit is at most L * (cell diagonal) above its value.
+    fine_error_ = lipschitz * params_.voxel_size * sqrt(3.0f);
+    coarse_error_ = lipschitz * brick_world_size_ * sqrt(3.0f);
+    // Coarse lookups are interpolations of corners at most a brick diagonal
+    // away, minus coarse_error_, so they are at most 2 * coarse_error_ below
+    // the distance. A brick needs voxels if the surface may be close enough
+    // for a coarse lookup in it to reach exact_distance, or within
+    // narrow_band of it.
+    const float band = params_.narrow_band * lipschitz +
+                       params_.exact_distance + 2 * coarse_error_;
+
+    // Points outside the grid are further than the band from the child.
+    child_box_ = child_->bounds();
+    AABB box = child_box_.expand(std::max(brick_world_size_, band));
+    vec3 size = box.size();
+    nx_ = std::max(1, int(ceil(size.x / brick_world_size_)));
+    ny_ = std::max(1, int(ceil(size.y / brick_world_size_)));
+    nz_ = std::max(1, int(ceil(size.z / brick_world_size_)));
+    box_ = AABB(box.min, box.min + vec3(nx_, ny_, nz_) * brick_world_size_);
+
+    size_t num_bricks = size_t(nx_) * ny_ * nz_;
+    size_t fixed_bytes = (size_t(nx_ + 1) * (ny_ + 1) * (nz_ + 1)) *
+                             sizeof(float) +
+                         num_bricks * sizeof(int);
+    if (fixed_bytes > params_.max_bytes) {
+      return false;
+    }
+
+    coarse_.clear();
+    for (int z = 0; z <= nz_; ++z) {
+      for (int y = 0; y <= ny_; ++y) {
+        for (int x = 0; x <= nx_; ++x) {
+          coarse_.push_back(distance(brickCorner(x, y, z)));
+        }
+      }
+    }
+
+    // A brick needs voxels if the surface may be within band of it.
+    const float half_diagonal = brick_world_size_ * sqrt(3.0f) / 2;
+    std::vector<int> fine;
+    brick_index_.assign(num_bricks, -1);
+    for (int z = 0; z < nz_; ++z) {
+      for (int y = 0; y < ny_; ++y) {
+        for (int x = 0; x < nx_; ++x) {
+          vec3 center = brickCorner(x, y, z) + vec3(1, 1, 1) *
+                                                   (brick_world_size_ / 2);
+          float dist = std::abs(distance(center)) - lipschitz * half_diagonal;
+          if (dist <= band) {
+            int index = (z * ny_ + y) * nx_ + x;
+            brick_index_[index] = fine.size();
+            fine.push_back(index);
+          }
+        }
+      }
+    }
+    if (fixed_bytes + fine.size() * brickSamples() * sizeof(float) >
+        params_.max_bytes) {
+      return false;
+    }
+
+    bricks_.clear();
+    bricks_.reserve(fine.size() * brickSamples());
+    for (int index : fine) {
+      vec3 corner = brickCorner(index % nx_, (index / nx_) % ny_,
+                                index / (nx_ * ny_));
+      for (int z = 0; z <= n; ++z) {
+        for (int y = 0; y <= n; ++y) {
+          for (int x = 0; x <= n; ++x) {
+            bricks_.push_back(
+                distance(corner + vec3(x, y, z) * params_.voxel_size));
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  vec3 brickCorner(int x, int y, int z) const {
+    return box_.min + vec3(x, y, z) * brick_world_size_;
+  }
+
+  float distance(const vec3& v) const {
+    return child_->sdf(v).dist;
+  }
+
+  SDF* child_;
+  Params params_;
+  AABB child_box_;
+  // The grid of bricks, around child_box_.
+  AABB box_;
+  float brick_world_size_ = 0;
+  float fine_error_ = 0;
+  float coarse_error_ = 0;
+  int nx_ = 0;
+  int ny_ = 0;
+  int nz_ = 0;
+  // Distances at brick corners, (nx + 1) * (ny + 1) * (nz + 1).
+  std::vector<float> coarse_;
+  // Index of each brick's voxels in bricks_, or -1.
+  std::vector<int> brick_index_;
+  // (brick_size + 1)^3 distances per fine brick.
+  std::vector<float> bricks_;
+};
+
+#endif
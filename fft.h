@@ -1,163 +1,695 @@
+/***
+ * Fast Fourier transforms of any size.
+ * Usage:
+ * #include "fft.h"
+ * const fft::Plan& plan = fft::Plan::get(1024);
+ * plan.forward(data);  // 1024 Complex values, transformed in place.
+ * plan.inverse(data);  // Scaled by 1 / 1024, so this restores data.
+ * fft::fft2d_mt(arr);  // Rows, then columns of an Array2D<Complex>.
+ * Array2D<fft::Complex> spectrum = fft::rfft2d_mt(real_arr);
+ * Array2D<float> restored = fft::irfft2d_mt(spectrum);
+ *
+ * A Plan holds the bit reversal permutation and the twiddle factors of its
+ * size, so transforms only run iterative radix-4 butterflies (plus one radix-2
+ * stage for odd powers of two) in place, without allocating. Sizes with prime
+ * factors 3, 5 and 7 use mixed radix Stockham stages through a per-thread
+ * scratch buffer, and other sizes Bluestein's algorithm, which costs a few
+ * times more than a power of two (see next_fast_size). Plans are built once
+ * per size by Plan::get and shared by all threads. The _mt variants of
+ * the 2D transforms split rows and columns over the global thread pool.
+ *
+ * Real inputs go through a RealPlan, which transforms n reals with a complex
+ * transform of size n / 2. rfft2d only keeps the width / 2 + 1 non-redundant
+ * columns of the spectrum (Hermitian symmetry), halving the work and memory.
+ ***/
+
 #ifndef FFT_H
 #define FFT_H
 
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
 #include <complex>
-#include <thread>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
 #include <valarray>
 #include <vector>
 
 #include "array2d.h"
+#include "logging.h"
+#include "thread_pool.h"
 
 namespace fft {
 
 typedef std::complex<float> Complex;
 typedef std::valarray<Complex> ComplexArray;
 
-inline void fft(ComplexArray& x) {
-  const size_t N = x.size();
-  if (N <= 1) return;
-
-  // divide
-  ComplexArray even = x[std::slice(0, N / 2, 2)];
-  ComplexArray odd = x[std::slice(1, N / 2, 2)];
-
-  // conquer
-  fft(even);
-  fft(odd);
+// a * b, or a * conj(b). Spelled out, as std::complex multiplication checks
+// for infinities and NaNs.
+template <bool conjugate = false>
+inline Complex mul(const Complex& a, const Complex& b) {
+  float bi = conjugate ? -b.imag() : b.imag();
+  return Complex(a.real() * b.real() - a.imag() * bi,
+                 a.real() * bi + a.imag() * b.real());
+}
 
-  // combine
-  for (size_t k = 0; k < N / 2; ++k) {
-    Complex t = std::polar<float>(1.0, -2 * M_PI * k / N) * odd[k];
-    x[k] = even[k] + t;
-    x[k + N / 2] = even[k] - t;
+// Plans are built once per size and never freed.
+template <class P>
+const P& cachedPlan(size_t n) {
+  static std::mutex mutex;
+  static std::map<size_t, std::unique_ptr<P>> plans;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<P>& plan = plans[n];
+  if (!plan) {
+    plan = std::make_unique<P>(n);
   }
+  return *plan;
 }
 
-inline void ifft(ComplexArray& x) {
-  x = x.apply(std::conj);
-  fft(x);
-  x = x.apply(std::conj);
-  x /= x.size();
-}
+class Plan {
+ public:
+  explicit Plan(size_t n) : n_(n) {
+    CHECK(n > 0) << "FFT of size 0";
+    if ((n & (n - 1)) == 0) {
+      algorithm_ = RADIX4;
+      initRadix4();
+    } else if (factor(n, &radices_)) {
+      algorithm_ = MIXED_RADIX;
+      initMixedRadix();
+    } else {
+      algorithm_ = BLUESTEIN;
+      initBluestein();
+    }
+  }
 
-namespace fft_mt {
+  // The shared plan for size n.
+  static const Plan& get(size_t n) { return cachedPlan<Plan>(n); }
 
-template <bool horizontal, bool forward>
-void fft2d_thread(Array2D<Complex>* arr, int block_min, int block_max) {
-  // std::cout << __FUNCTION__ << " min " << block_min << " max " << block_max
-  // << std::endl;
-  for (int i = block_min; i < block_max; ++i) {
-    ComplexArray slice;
-    if constexpr (horizontal) {
-      slice = arr->row(i).template copy<ComplexArray>();
+  size_t size() const { return n_; }
+
+  void forward(Complex* data) const {
+    if (algorithm_ == RADIX4) {
+      radix4<false>(data);
     } else {
-      slice = arr->column(i).template copy<ComplexArray>();
+      transform(data);
+    }
+  }
+
+  // Scaled by 1 / n.
+  void inverse(Complex* data) const {
+    if (algorithm_ == RADIX4) {
+      radix4<true>(data);
+      return;
+    }
+    // conj(forward(conj(x))) / n.
+    for (size_t i = 0; i < n_; ++i) {
+      data[i] = std::conj(data[i]);
+    }
+    transform(data);
+    const float scale = 1.0f / n_;
+    for (size_t i = 0; i < n_; ++i) {
+      data[i] = std::conj(data[i]) * scale;
+    }
+  }
+
+  // Whether n only has prime factors 2, 3, 5 and 7.
+  static bool isFast(size_t n) {
+    std::vector<int> radices;
+    return factor(n, &radices);
+  }
+
+ private:
+  enum Algorithm { RADIX4, MIXED_RADIX, BLUESTEIN };
+
+  // Splits n into radices 4, 2, 3, 5 and 7. Returns false if n has other
+  // prime factors.
+  static bool factor(size_t n, std::vector<int>* radices) {
+    for (int radix : {4, 2, 3, 5, 7}) {
+      while (n % radix == 0) {
+        radices->push_back(radix);
+        n /= radix;
+      }
+    }
+    return n == 1;
+  }
+
+  static Complex root(double turns) {
+    double angle = -2 * M_PI * turns;
+    return Complex(cos(angle), sin(angle));
+  }
+
+  void initRadix4() {
+    int log2n = 0;
+    while ((size_t(1) << log2n) < n_) {
+      log2n++;
     }
-    if constexpr (forward) {
-      fft(slice);
+    for (size_t i = 0; i < n_; ++i) {
+      size_t r = 0;
+      for (int b = 0; b < log2n; ++b) {
+        r |= ((i >> b) & 1) << (log2n - 1 - b);
+      }
+      if (i < r) {
+        swaps_.push_back({uint32_t(i), uint32_t(r)});
+      }
+    }
+    first_radix2_ = log2n % 2 == 1;
+    // w^k, w^2k and w^3k for k < len, with w = exp(-2 pi i / (4 len)), for
+    // every radix-4 stage in order.
+    for (size_t len = first_radix2_ ? 2 : 1; len < n_; len *= 4) {
+      for (size_t k = 0; k < len; ++k) {
+        for (int j = 1; j <= 3; ++j) {
+          twiddles_.push_back(root(double(j * k) / (4 * len)));
+        }
+      }
+    }
+  }
+
+  // Stockham stages: the stage of radix r splits the current length len into
+  // r interleaved transforms of length len / r, and needs w^(p * k) for
+  // p < len / r and 0 < k < r, with w = exp(-2 pi i / len).
+  void initMixedRadix() {
+    size_t len = n_;
+    for (int radix : radices_) {
+      size_t m = len / radix;
+      for (size_t p = 0; p < m; ++p) {
+        for (int k = 1; k < radix; ++k) {
+          twiddles_.push_back(root(double(p * k) / len));
+        }
+      }
+      len = m;
+    }
+  }
+
+  // Bluestein: with c[k] = exp(-pi i k^2 / n), the transform is
+  // c[k] * sum(x[j] * c[j] * conj(c[k - j])), a circular convolution which
+  // is computed with power of two transforms of size >= 2n - 1.
+  void initBluestein() {
+    size_t padded_size = 1;
+    while (padded_size < 2 * n_ - 1) {
+      padded_size *= 2;
+    }
+    padded_ = std::make_unique<Plan>(padded_size);
+    for (size_t k = 0; k < n_; ++k) {
+      // k^2 mod 2n keeps the angle exact for large k.
+      uint64_t k2 = uint64_t(k) * k % (2 * n_);
+      chirp_.push_back(root(double(k2) / (2 * n_)));
+    }
+    chirp_spectrum_.assign(padded_size, 0);
+    for (size_t k = 0; k < n_; ++k) {
+      chirp_spectrum_[k] = std::conj(chirp_[k]);
+      if (k > 0) {
+        chirp_spectrum_[padded_size - k] = std::conj(chirp_[k]);
+      }
+    }
+    padded_->forward(chirp_spectrum_.data());
+  }
+
+  template <bool inverse>
+  void radix4(Complex* data) const {
+    for (const auto& [i, j] : swaps_) {
+      std::swap(data[i], data[j]);
+    }
+    size_t len = 1;
+    if (first_radix2_) {
+      for (size_t i = 0; i < n_; i += 2) {
+        Complex a = data[i];
+        Complex b = data[i + 1];
+        data[i] = a + b;
+        data[i + 1] = a - b;
+      }
+      len = 2;
+    }
+    // Each block of 4 * len holds the transforms of its elements of index 0,
+    // 2, 1 and 3 mod 4, in that order, which are combined in place.
+    const Complex* w = twiddles_.data();
+    for (; len < n_; len *= 4) {
+      for (size_t block = 0; block < n_; block += 4 * len) {
+        Complex* p = data + block;
+        for (size_t k = 0; k < len; ++k) {
+          Complex y0 = p[k];
+          Complex t2 = mul<inverse>(p[k + len], w[3 * k + 1]);
+          Complex t1 = mul<inverse>(p[k + 2 * len], w[3 * k]);
+          Complex t3 = mul<inverse>(p[k + 3 * len], w[3 * k + 2]);
+          Complex a0 = y0 + t2;
+          Complex a1 = y0 - t2;
+          Complex b0 = t1 + t3;
+          Complex b1 = t1 - t3;
+          // -i * b1 forward, i * b1 inverse.
+          Complex rotated = inverse ? Complex(-b1.imag(), b1.real())
+                                    : Complex(b1.imag(), -b1.real());
+          p[k] = a0 + b0;
+          p[k + len] = a1 + rotated;
+          p[k + 2 * len] = a0 - b0;
+          p[k + 3 * len] = a1 - rotated;
+        }
+      }
+      w += 3 * len;
+    }
+    if constexpr (inverse) {
+      const float scale = 1.0f / n_;
+      for (size_t i = 0; i < n_; ++i) {
+        data[i] *= scale;
+      }
+    }
+  }
+
+  // Forward transform of a size which is not a power of two.
+  void transform(Complex* data) const {
+    if (algorithm_ == MIXED_RADIX) {
+      mixedRadix(data);
     } else {
-      ifft(slice);
+      bluestein(data);
     }
-    if constexpr (horizontal) {
-      arr->row(i) = slice;
+  }
+
+  // Transform of size radix of a[0], ..., a[radix - 1], into b.
+  template <int radix>
+  static void butterfly(const Complex* a, Complex* b) {
+    // -i * z.
+    auto rotate = [](const Complex& z) { return Complex(z.imag(), -z.real()); };
+    if constexpr (radix == 2) {
+      b[0] = a[0] + a[1];
+      b[1] = a[0] - a[1];
+    } else if constexpr (radix == 3) {
+      const float sin1 = 0.866025403784438647;  // sin(2 pi / 3).
+      Complex t1 = a[1] + a[2];
+      Complex t2 = a[0] - t1 * 0.5f;
+      Complex t3 = rotate(a[1] - a[2]) * sin1;
+      b[0] = a[0] + t1;
+      b[1] = t2 + t3;
+      b[2] = t2 - t3;
+    } else if constexpr (radix == 4) {
+      Complex a02 = a[0] + a[2];
+      Complex s02 = a[0] - a[2];
+      Complex a13 = a[1] + a[3];
+      Complex t = rotate(a[1] - a[3]);
+      b[0] = a02 + a13;
+      b[1] = s02 + t;
+      b[2] = a02 - a13;
+      b[3] = s02 - t;
+    } else if constexpr (radix == 5) {
+      const float cos1 = 0.309016994374947424;   // cos(2 pi / 5).
+      const float cos2 = -0.809016994374947424;  // cos(4 pi / 5).
+      const float sin1 = 0.951056516295153572;   // sin(2 pi / 5).
+      const float sin2 = 0.587785252292473129;   // sin(4 pi / 5).
+      Complex t1 = a[1] + a[4];
+      Complex t2 = a[2] + a[3];
+      Complex t3 = rotate(a[1] - a[4]);
+      Complex t4 = rotate(a[2] - a[3]);
+      Complex m1 = a[0] + t1 * cos1 + t2 * cos2;
+      Complex m2 = a[0] + t1 * cos2 + t2 * cos1;
+      Complex n1 = t3 * sin1 + t4 * sin2;
+      Complex n2 = t3 * sin2 - t4 * sin1;
+      b[0] = a[0] + t1 + t2;
+      b[1] = m1 + n1;
+      b[4] = m1 - n1;
+      b[2] = m2 + n2;
+      b[3] = m2 - n2;
     } else {
-      arr->column(i) = slice;
+      static const std::vector<Complex> roots = smallRoots(radix);
+      for (int k = 0; k < radix; ++k) {
+        Complex sum = a[0];
+        int jk = 0;
+        for (int j = 1; j < radix; ++j) {
+          jk += k;
+          if (jk >= radix) {
+            jk -= radix;
+          }
+          sum += mul(a[j], roots[jk]);
+        }
+        b[k] = sum;
+      }
     }
   }
-}
 
-}  // namespace fft_mt
+  static std::vector<Complex> smallRoots(int r) {
+    std::vector<Complex> res;
+    for (int j = 0; j < r; ++j) {
+      res.push_back(root(double(j) / r));
+    }
+    return res;
+  }
 
-inline void fft2d_mt(Array2D<Complex>& arr) {
-  const int num_threads = std::thread::hardware_concurrency();
-  int row_block_size = arr.height() / num_threads;
-  std::vector<std::thread> threads;
-  for (int i = 0; i < num_threads; ++i) {
-    int block_min = i * row_block_size;
-    int block_max = block_min + row_block_size;
-    if (i == num_threads - 1) {
-      block_max = arr.height();
+  // One Stockham stage, from x to y: stride interleaved transforms of length
+  // radix * m are split into radix * stride interleaved transforms of length m.
+  template <int radix>
+  static void stage(const Complex* x, Complex* y, size_t stride, size_t m,
+                    const Complex* w) {
+    const size_t step = stride * m;
+    Complex a[radix];
+    Complex b[radix];
+    Complex twiddles[radix];
+    for (size_t p = 0; p < m; ++p) {
+      const Complex* in = x + stride * p;
+      Complex* out = y + stride * radix * p;
+#pragma GCC unroll 8
+      for (int k = 1; k < radix; ++k) {
+        twiddles[k] = w[p * (radix - 1) + k - 1];
+      }
+      for (size_t q = 0; q < stride; ++q) {
+#pragma GCC unroll 8
+        for (int j = 0; j < radix; ++j) {
+          a[j] = in[q + j * step];
+        }
+        butterfly<radix>(a, b);
+        out[q] = b[0];
+#pragma GCC unroll 8
+        for (int k = 1; k < radix; ++k) {
+          out[q + stride * k] = mul(b[k], twiddles[k]);
+        }
+      }
     }
-    threads.push_back(std::thread(fft_mt::fft2d_thread<true, true>, &arr,
-                                  block_min, block_max));
   }
-  for (std::thread& thread : threads) {
-    thread.join();
+
+  void mixedRadix(Complex* data) const {
+    thread_local std::vector<Complex> scratch;
+    if (scratch.size() < n_) {
+      scratch.resize(n_);
+    }
+    Complex* x = data;
+    Complex* y = scratch.data();
+    size_t stride = 1;
+    size_t len = n_;
+    const Complex* w = twiddles_.data();
+    for (int radix : radices_) {
+      const size_t m = len / radix;
+      switch (radix) {
+        case 2:
+          stage<2>(x, y, stride, m, w);
+          break;
+        case 3:
+          stage<3>(x, y, stride, m, w);
+          break;
+        case 4:
+          stage<4>(x, y, stride, m, w);
+          break;
+        case 5:
+          stage<5>(x, y, stride, m, w);
+          break;
+        case 7:
+          stage<7>(x, y, stride, m, w);
+          break;
+      }
+      w += m * (radix - 1);
+      stride *= radix;
+      len = m;
+      std::swap(x, y);
+    }
+    if (x != data) {
+      std::copy_n(x, n_, data);
+    }
   }
 
-  threads.clear();
-  int col_block_size = arr.width() / num_threads;
-  for (int i = 0; i < num_threads; ++i) {
-    int block_min = i * col_block_size;
-    int block_max = block_min + col_block_size;
-    if (i == num_threads - 1) {
-      block_max = arr.width();
+  void bluestein(Complex* data) const {
+    thread_local std::vector<Complex> buffer;
+    const size_t padded_size = padded_->size();
+    if (buffer.size() < padded_size) {
+      buffer.resize(padded_size);
+    }
+    for (size_t k = 0; k < n_; ++k) {
+      buffer[k] = mul(data[k], chirp_[k]);
+    }
+    std::fill(buffer.begin() + n_, buffer.begin() + padded_size, 0);
+    padded_->forward(buffer.data());
+    for (size_t i = 0; i < padded_size; ++i) {
+      buffer[i] = mul(buffer[i], chirp_spectrum_[i]);
+    }
+    padded_->inverse(buffer.data());
+    for (size_t k = 0; k < n_; ++k) {
+      data[k] = mul(buffer[k], chirp_[k]);
     }
-    threads.push_back(std::thread(fft_mt::fft2d_thread<false, true>, &arr,
-                                  block_min, block_max));
   }
-  for (std::thread& thread : threads) {
-    thread.join();
+
+  size_t n_;
+  Algorithm algorithm_;
+  // Radix-4.
+  bool first_radix2_ = false;
+  std::vector<std::pair<uint32_t, uint32_t>> swaps_;
+  // Radix-4 and mixed radix, stage by stage.
+  std::vector<Complex> twiddles_;
+  // Mixed radix.
+  std::vector<int> radices_;
+  // Bluestein.
+  std::unique_ptr<Plan> padded_;
+  std::vector<Complex> chirp_;
+  std::vector<Complex> chirp_spectrum_;
+};
+
+// The smallest size >= n whose transforms avoid Bluestein's algorithm.
+inline size_t next_fast_size(size_t n) {
+  while (!Plan::isFast(n)) {
+    n++;
   }
+  return n;
 }
 
-inline void ifft2d_mt(Array2D<Complex>& arr) {
-  const int num_threads = std::thread::hardware_concurrency();
-  int row_block_size = arr.height() / num_threads;
-  std::vector<std::thread> threads;
-  for (int i = 0; i < num_threads; ++i) {
-    int block_min = i * row_block_size;
-    int block_max = block_min + row_block_size;
-    if (i == num_threads - 1) {
-      block_max = arr.height();
+// Transforms of n real values through a complex transform of size n / 2.
+// The n values are packed in pairs into n / 2 Complex, (x[0], x[1]),
+// (x[2], x[3])..., and their transform is the n / 2 + 1 first bins of the
+// complex transform; the others are the conjugates of bins n - k. data must
+// have room for n / 2 + 1 Complex.
+class RealPlan {
+ public:
+  explicit RealPlan(size_t n) : n_(n), half_(Plan::get(n / 2)) {
+    CHECK(n >= 2 && n % 2 == 0) << "real FFT of odd size " << n;
+    for (size_t k = 0; k < n / 2; ++k) {
+      double angle = -2 * M_PI * k / n;
+      twiddles_.push_back(Complex(cos(angle), sin(angle)));
+    }
+  }
+
+  static const RealPlan& get(size_t n) { return cachedPlan<RealPlan>(n); }
+
+  size_t size() const { return n_; }
+
+  // Packed reals to bins.
+  void forward(Complex* data) const {
+    const size_t m = n_ / 2;
+    half_.forward(data);
+    // With z the transform of the packed values, the transforms of the even
+    // and odd values are e = (z[k] + conj(z[m - k])) / 2 and
+    // o = (z[k] - conj(z[m - k])) / 2i, and x[k] = e + w^k * o.
+    Complex z0 = data[0];
+    data[0] = Complex(z0.real() + z0.imag(), 0);
+    data[m] = Complex(z0.real() - z0.imag(), 0);
+    for (size_t k = 1; k <= m / 2; ++k) {
+      Complex a = data[k];
+      Complex b = std::conj(data[m - k]);
+      Complex e = (a + b) * 0.5f;
+      Complex d = (a - b) * 0.5f;
+      Complex wo = mul(Complex(d.imag(), -d.real()), twiddles_[k]);
+      data[k] = e + wo;
+      data[m - k] = std::conj(e - wo);
     }
-    threads.push_back(std::thread(fft_mt::fft2d_thread<true, false>, &arr,
-                                  block_min, block_max));
   }
-  for (std::thread& thread : threads) {
-    thread.join();
+
+  // Bins to packed reals, scaled by 1 / n.
+  void inverse(Complex* data) const {
+    const size_t m = n_ / 2;
+    float x0 = data[0].real();
+    float xm = data[m].real();
+    data[0] = Complex((x0 + xm) * 0.5f, (x0 - xm) * 0.5f);
+    for (size_t k = 1; k <= m / 2; ++k) {
+      Complex a = data[k];
+      Complex b = std::conj(data[m - k]);
+      Complex e = (a + b) * 0.5f;
+      Complex o = mul<true>((a - b) * 0.5f, twiddles_[k]);
+      // z[k] = e + i * o, and e and o are conjugated at m - k.
+      data[k] = Complex(e.real() - o.imag(), e.imag() + o.real());
+      data[m - k] = Complex(e.real() + o.imag(), o.real() - e.imag());
+    }
+    half_.inverse(data);
   }
 
-  threads.clear();
-  int col_block_size = arr.width() / num_threads;
-  for (int i = 0; i < num_threads; ++i) {
-    int block_min = i * col_block_size;
-    int block_max = block_min + col_block_size;
-    if (i == num_threads - 1) {
-      block_max = arr.width();
+ private:
+  size_t n_;
+  const Plan& half_;
+  std::vector<Complex> twiddles_;
+};
+
+inline void fft(ComplexArray& x) {
+  if (x.size() <= 1) return;
+  Plan::get(x.size()).forward(&x[0]);
+}
+
+inline void ifft(ComplexArray& x) {
+  if (x.size() <= 1) return;
+  Plan::get(x.size()).inverse(&x[0]);
+}
+
+namespace fft_mt {
+
+// Number of columns transformed together: 8 Complex are a 64 byte cache line.
+const int kColumnBlock = 8;
+
+// Transforms rows (or columns) [block_min, block_max) of arr in place.
+template <bool horizontal, bool forward>
+void fft2d_thread(Array2D<Complex>* arr, int block_min, int block_max) {
+  if constexpr (horizontal) {
+    const Plan& plan = Plan::get(arr->width());
+    for (int i = block_min; i < block_max; ++i) {
+      Complex* row = &(*arr)(0, i);
+      forward ? plan.forward(row) : plan.inverse(row);
+    }
+  } else {
+    // Columns are transposed kColumnBlock at a time into contiguous buffers,
+    // so that every cache line of the array is read and written once. Rows
+    // may be padded (see Array2D::paddedPitch), so that the lines of a column
+    // block do not all map to the same cache sets.
+    const size_t pitch = arr->pitch();
+    const int height = arr->height();
+    const Plan& plan = Plan::get(height);
+    std::vector<Complex> columns(size_t(kColumnBlock) * height);
+    for (int i = block_min; i < block_max; i += kColumnBlock) {
+      const int num_columns = std::min(kColumnBlock, block_max - i);
+      Complex* src = &(*arr)(i, 0);
+      for (int y = 0; y < height; ++y) {
+        const Complex* row = src + y * pitch;
+        for (int c = 0; c < num_columns; ++c) {
+          columns[size_t(c) * height + y] = row[c];
+        }
+      }
+      for (int c = 0; c < num_columns; ++c) {
+        Complex* column = &columns[size_t(c) * height];
+        forward ? plan.forward(column) : plan.inverse(column);
+      }
+      for (int y = 0; y < height; ++y) {
+        Complex* row = src + y * pitch;
+        for (int c = 0; c < num_columns; ++c) {
+          row[c] = columns[size_t(c) * height + y];
+        }
+      }
     }
-    threads.push_back(std::thread(fft_mt::fft2d_thread<false, false>, &arr,
-                                  block_min, block_max));
   }
-  for (std::thread& thread : threads) {
-    thread.join();
+}
+
+// Real transforms of rows [block_min, block_max) of a half spectrum (see
+// rfft2d) in place.
+template <bool forward>
+void rfft2d_thread(Array2D<Complex>* arr, int block_min, int block_max) {
+  const RealPlan& plan = RealPlan::get(2 * (arr->width() - 1));
+  for (int i = block_min; i < block_max; ++i) {
+    Complex* row = &(*arr)(0, i);
+    forward ? plan.forward(row) : plan.inverse(row);
   }
 }
 
-inline void fft2d(Array2D<Complex>& arr) {
-  for (int y = 0; y < arr.height(); ++y) {
-    ComplexArray row = arr.row(y).template copy<ComplexArray>();
-    fft(row);
-    arr.row(y) = row;
+template <bool threaded, class F>
+void run(int size, const F& f) {
+  if constexpr (threaded) {
+    parallel_for(0, size, f);
+  } else {
+    f(0, size);
   }
-  for (int x = 0; x < arr.width(); ++x) {
-    ComplexArray col = arr.column(x).template copy<ComplexArray>();
-    fft(col);
-    arr.column(x) = col;
+}
+
+template <bool threaded, bool forward>
+void fft2d(Array2D<Complex>& arr) {
+  auto rows = [&arr](int min, int max) {
+    fft2d_thread<true, forward>(&arr, min, max);
+  };
+  auto columns = [&arr](int min, int max) {
+    fft2d_thread<false, forward>(&arr, min, max);
+  };
+  if constexpr (forward) {
+    run<threaded>(arr.height(), rows);
+    run<threaded>(arr.width(), columns);
+  } else {
+    run<threaded>(arr.width(), columns);
+    run<threaded>(arr.height(), rows);
   }
 }
 
-inline void ifft2d(Array2D<Complex>& arr) {
-  for (int x = 0; x < arr.width(); ++x) {
-    ComplexArray col = arr.column(x).template copy<ComplexArray>();
-    ifft(col);
-    arr.column(x) = col;
+template <bool threaded, bool forward>
+void rfft2d_packed(Array2D<Complex>& arr) {
+  auto rows = [&arr](int min, int max) {
+    rfft2d_thread<forward>(&arr, min, max);
+  };
+  auto columns = [&arr](int min, int max) {
+    fft2d_thread<false, forward>(&arr, min, max);
+  };
+  if constexpr (forward) {
+    run<threaded>(arr.height(), rows);
+    run<threaded>(arr.width(), columns);
+  } else {
+    run<threaded>(arr.width(), columns);
+    run<threaded>(arr.height(), rows);
   }
+}
+
+template <bool threaded>
+Array2D<Complex> rfft2d(const Array2D<float>& arr) {
+  const int width = arr.width();
+  CHECK(width % 2 == 0) << "real FFT of odd width " << width;
+  Array2D<Complex> res(width / 2 + 1, arr.height());
   for (int y = 0; y < arr.height(); ++y) {
-    ComplexArray row = arr.row(y).template copy<ComplexArray>();
-    ifft(row);
-    arr.row(y) = row;
+    std::copy_n(&arr(0, y), width, reinterpret_cast<float*>(&res(0, y)));
+  }
+  rfft2d_packed<threaded, true>(res);
+  return res;
+}
+
+template <bool threaded>
+Array2D<float> irfft2d(Array2D<Complex>& spectrum) {
+  const int width = 2 * (spectrum.width() - 1);
+  rfft2d_packed<threaded, false>(spectrum);
+  Array2D<float> res(width, spectrum.height());
+  for (int y = 0; y < spectrum.height(); ++y) {
+    std::copy_n(reinterpret_cast<const float*>(&spectrum(0, y)), width,
+                &res(0, y));
   }
+  return res;
+}
+
+}  // namespace fft_mt
+
+inline void fft2d_mt(Array2D<Complex>& arr) {
+  fft_mt::fft2d<true, true>(arr);
+}
+
+inline void ifft2d_mt(Array2D<Complex>& arr) {
+  fft_mt::fft2d<true, false>(arr);
+}
+
+inline void fft2d(Array2D<Complex>& arr) {
+  fft_mt::fft2d<false, true>(arr);
+}
+
+inline void ifft2d(Array2D<Complex>& arr) {
+  fft_mt::fft2d<false, false>(arr);
+}
+
+// The transform of a real array of even width w: its first w / 2 + 1 columns,
+// as the others are the conjugates of columns w - x (mirrored vertically).
+inline Array2D<Complex> rfft2d(const Array2D<float>& arr) {
+  return fft_mt::rfft2d<false>(arr);
+}
+
+inline Array2D<Complex> rfft2d_mt(const Array2D<float>& arr) {
+  return fft_mt::rfft2d<true>(arr);
+}
+
+// The inverse of rfft2d. Overwrites spectrum.
+inline Array2D<float> irfft2d(Array2D<Complex>& spectrum) {
+  return fft_mt::irfft2d<false>(spectrum);
+}
+
+inline Array2D<float> irfft2d_mt(Array2D<Complex>& spectrum) {
+  return fft_mt::irfft2d<true>(spectrum);
+}
+
+// rfft2d in place: each row of arr holds the 2 * (width - 1) reals of a row of
+// the input, packed in pairs, and is replaced by the row of the spectrum.
+inline void rfft2d_packed_mt(Array2D<Complex>& arr) {
+  fft_mt::rfft2d_packed<true, true>(arr);
+}
+
+// irfft2d in place, leaving packed reals in each row.
+inline void irfft2d_packed_mt(Array2D<Complex>& arr) {
+  fft_mt::rfft2d_packed<true, false>(arr);
 }
 
 }  // namespace fft
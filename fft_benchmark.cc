@@ -0,0 +1,78 @@
+// Times the passes of 2D FFTs at 1K, 2K and 4K sizes, on arrays with and
+// without padded rows (see Array2D::paddedPitch).
+// Usage: fft_benchmark [--max_size=4096] [--repeat=3]
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "array2d.h"
+#include "fft.h"
+
+ABSL_FLAG(int, max_size, 4096, "Largest size, starting from 1024");
+ABSL_FLAG(int, repeat, 3, "Number of runs");
+
+// Returns the time per run in milliseconds.
+template <class F>
+double benchmark(const F& f) {
+  int repeat = absl::GetFlag(FLAGS_repeat);
+  f();  // Warm up.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / repeat;
+}
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  float sum = 0;
+  for (int n = 1024; n <= absl::GetFlag(FLAGS_max_size); n *= 2) {
+    Array2D<fft::Complex> arr(n, n);
+    for (int i = 0; i < arr.size(); ++i) {
+      arr(i) = fft::Complex(i % 7, i % 3);
+    }
+    Array2D<fft::Complex> padded(n, n, Array2D<fft::Complex>::paddedPitch(n));
+    for (int y = 0; y < n; ++y) {
+      std::copy_n(&arr(0, y), n, &padded(0, y));
+    }
+    Array2D<fft::Complex> packed(n / 2 + 1, n);
+    double rows_ms = benchmark([&]() {
+      fft::fft_mt::fft2d_thread<true, true>(&arr, 0, n);
+      fft::fft_mt::fft2d_thread<true, false>(&arr, 0, n);
+    });
+    double columns_ms = benchmark([&]() {
+      fft::fft_mt::fft2d_thread<false, true>(&arr, 0, n);
+      fft::fft_mt::fft2d_thread<false, false>(&arr, 0, n);
+    });
+    double fft2d_mt_ms = benchmark([&]() {
+      fft::fft2d_mt(arr);
+      fft::ifft2d_mt(arr);
+    });
+    double padded_columns_ms = benchmark([&]() {
+      fft::fft_mt::fft2d_thread<false, true>(&padded, 0, n);
+      fft::fft_mt::fft2d_thread<false, false>(&padded, 0, n);
+    });
+    double padded_fft2d_mt_ms = benchmark([&]() {
+      fft::fft2d_mt(padded);
+      fft::ifft2d_mt(padded);
+    });
+    double rfft2d_mt_ms = benchmark([&]() {
+      fft::rfft2d_packed_mt(packed);
+      fft::irfft2d_packed_mt(packed);
+    });
+    sum += arr(n / 2).real() + padded(n / 2, 0).real() + packed(n / 4).real();
+    std::cout << n << 'x' << n << ", ms per forward + inverse: rows "
+              << rows_ms << ", columns " << columns_ms << ", fft2d_mt "
+              << fft2d_mt_ms << ", rfft2d_packed_mt " << rfft2d_mt_ms
+              << "; with padded rows: columns " << padded_columns_ms
+              << ", fft2d_mt " << padded_fft2d_mt_ms << std::endl;
+  }
+  // Keeps the results alive.
+  std::cout << "checksum: " << sum << std::endl;
+  return 0;
+}
@@ -1,22 +1,29 @@
 #ifndef FILTER_H
 #define FILTER_H
 
-#include "array2d.h"
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <tuple>
+#include <vector>
+
+#include "array2d.h"
 #include "math.h"
 #include "image.h"
 #include "fft.h"
+#include "kernel_cache.h"
+#include "thread_pool.h"
 
 typedef Array2D<fft::Complex> ComplexArray2D;
 
 namespace filters {
-  ComplexArray2D Id(int width, int height) {
+  inline ComplexArray2D Id(int width, int height) {
     ComplexArray2D res(width, height);
     res(0, 0) = 1;
     return res;
   }
 
-  ComplexArray2D Blur(int width, int height) {
+  inline ComplexArray2D Blur(int width, int height) {
     ComplexArray2D res(width, height);
     for (int y = 0; y < height; ++y) {
       for (int x = 0; x < width; ++x) {
@@ -30,6 +37,21 @@ namespace filters {
     return res;
   }
 
+  // exp(-r^2 / (2 sigma^2)), which is separable.
+  inline ComplexArray2D Gaussian(int width, int height, float sigma) {
+    ComplexArray2D res(width, height);
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        int dx = x - width / 2;
+        int dy = y - height / 2;
+        res(x, y) = exp(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+      }
+    }
+    res = res.rotate(width / 2, height / 2);
+    res.inormalize();
+    return res;
+  }
+
   // TODO: move this to some general utils place (and I probably need this elsewhere).
   inline float pos_fmod(float x, float m) {
     float res = fmod(x, m);
@@ -39,7 +61,7 @@ namespace filters {
     return res;
   }
 
-  ComplexArray2D Ray(int width, int height, int spokes=8, float rotation=(2 * M_PI) / 100, float ray_width=M_PI / 64) {
+  inline ComplexArray2D Ray(int width, int height, int spokes=8, float rotation=(2 * M_PI) / 100, float ray_width=M_PI / 64) {
     ComplexArray2D res(width, height);
     float arc = (2 * M_PI) / spokes;
     float mid_arc = arc / 2;
@@ -65,26 +87,580 @@ namespace filters {
     return res;
   }
 
-  ComplexArray2D Bloom(int width, int height) {
-    ComplexArray2D res(width, height);
-    res = Id(width, height);
-    res.iaverage(Ray(width, height));
-    res.iaverage(Blur(width, height));
-    return res;
+  inline ComplexArray2D Bloom(int width, int height) {
+    ComplexArray2D id = Id(width, height);
+    ComplexArray2D ray = Ray(width, height);
+    ComplexArray2D blur = Blur(width, height);
+    return ((id + ray) / 2 + blur) / 2;
+  }
+
+  // The fft2d of Bloom(width, height), built once per size (see
+  // kernel_cache.h). The key changes whenever Bloom does.
+  inline const ComplexArray2D& BloomSpectrum(int width, int height) {
+    std::string key =
+        "bloom_v2_" + std::to_string(width) + "x" + std::to_string(height);
+    return GlobalKernelCache::instance().get(
+        key, width, height, [width, height]() { return Bloom(width, height); });
+  }
+
+  // Convolves with the filter whose fft2d is transformed_filter, all 3
+  // channels at once. As the filter is real, convolving red + i * green with
+  // it gives the red result in the real part and the green one in the
+  // imaginary part, so both share one complex FFT. Blue goes through a real
+  // FFT, using the first half of the same filter spectrum. Real FFTs need an
+  // even width, so for odd widths blue goes through a complex FFT with a zero
+  // imaginary part instead.
+  inline void ConvolveSpectrum(Image& image,
+                               const ComplexArray2D& transformed_filter) {
+    const int width = image.width();
+    const int height = image.height();
+    const bool real_blue = width % 2 == 0;
+
+    ComplexArray2D red_green(width, height,
+                             ComplexArray2D::paddedPitch(width));
+    const int blue_width = real_blue ? width / 2 + 1 : width;
+    ComplexArray2D blue(blue_width, height,
+                        ComplexArray2D::paddedPitch(blue_width));
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        float* blue_row = reinterpret_cast<float*>(&blue(0, y));
+        for (int x = 0; x < width; ++x) {
+          const Color& color = image(x, y);
+          red_green(x, y) = fft::Complex(color.r, color.g);
+          if (real_blue) {
+            blue_row[x] = color.b;
+          } else {
+            blue(x, y) = color.b;
+          }
+        }
+      }
+    });
+    fft::fft2d_mt(red_green);
+    if (real_blue) {
+      fft::rfft2d_packed_mt(blue);
+    } else {
+      fft::fft2d_mt(blue);
+    }
+
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        for (int x = 0; x < width; ++x) {
+          red_green(x, y) = fft::mul(red_green(x, y), transformed_filter(x, y));
+        }
+        for (int x = 0; x < blue.width(); ++x) {
+          blue(x, y) = fft::mul(blue(x, y), transformed_filter(x, y));
+        }
+      }
+    });
+    fft::ifft2d_mt(red_green);
+    if (real_blue) {
+      fft::irfft2d_packed_mt(blue);
+    } else {
+      fft::ifft2d_mt(blue);
+    }
+
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        const float* blue_row = reinterpret_cast<const float*>(&blue(0, y));
+        for (int x = 0; x < width; ++x) {
+          const fft::Complex& rg = red_green(x, y);
+          const float b = real_blue ? blue_row[x] : blue(x, y).real();
+          image(x, y) = Color(rg.real(), rg.imag(), b);
+        }
+      }
+    });
   }
 
-  void Convolve(Image& image, const ComplexArray2D& filter) {
+  inline void ConvolveFFT(Image& image, const ComplexArray2D& filter) {
     ComplexArray2D transformed_filter = filter;
     fft::fft2d_mt(transformed_filter);
-    for (int channel_id = Image::RED; channel_id <= Image::BLUE; ++channel_id) {
-      Image::Channel channel = Image::Channel(channel_id);
-      ComplexArray2D c = image.getChannel(channel);
-      fft::fft2d_mt(c);
-      c *= transformed_filter;
-      fft::ifft2d_mt(c);
-      Array2D<float> arr = c.transform<float>([](fft::Complex c) {return c.real();});
-      image.setChannel(channel, arr);
+    ConvolveSpectrum(image, transformed_filter);
+  }
+
+  // Circular convolution with filter(x, y) = row[x + r] * column[y + r'],
+  // where row and column have odd sizes 2r + 1 and 2r' + 1, as a pass over
+  // the rows then one over the columns. Rows are handled as floats, with
+  // neighbouring pixels 3 floats apart.
+  inline void ConvolveSeparable(Image& image, const std::vector<float>& row,
+                                const std::vector<float>& column) {
+    CHECK(row.size() % 2 == 1 && column.size() % 2 == 1)
+        << "kernels must have odd sizes, not " << row.size() << " and "
+        << column.size();
+    const int width = image.width();
+    const int height = image.height();
+    const int row_radius = row.size() / 2;
+    const int column_radius = column.size() / 2;
+
+    Image rows(width, height);
+    parallel_for(0, height, [&](int min, int max) {
+      // padded[x] = image(x - row_radius) with wrapping.
+      std::vector<Color> padded(width + 2 * row_radius);
+      for (int y = min; y < max; ++y) {
+        for (int x = 0; x < int(padded.size()); ++x) {
+          padded[x] = image(((x - row_radius) % width + width) % width, y);
+        }
+        float* out = reinterpret_cast<float*>(&rows(0, y));
+        for (int k = 0; k < int(row.size()); ++k) {
+          if (row[k] == 0) {
+            continue;
+          }
+          // image(x - (k - row_radius)) = padded[x + 2 * row_radius - k].
+          const float* in =
+              reinterpret_cast<const float*>(&padded[2 * row_radius - k]);
+          for (int i = 0; i < 3 * width; ++i) {
+            out[i] += row[k] * in[i];
+          }
+        }
+      }
+    });
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        float* out = reinterpret_cast<float*>(&image(0, y));
+        std::fill(out, out + 3 * width, 0.f);
+        for (int k = 0; k < int(column.size()); ++k) {
+          if (column[k] == 0) {
+            continue;
+          }
+          int source_y = ((y - k + column_radius) % height + height) % height;
+          const float* in = reinterpret_cast<const float*>(&rows(0, source_y));
+          for (int i = 0; i < 3 * width; ++i) {
+            out[i] += column[k] * in[i];
+          }
+        }
+      }
+    });
+  }
+
+  // Circular convolution with the filter which is `weight` at each
+  // (dx, dy, weight) of `taps` and 0 elsewhere.
+  inline void ConvolveDirect(
+      Image& image, const std::vector<std::tuple<int, int, float>>& taps) {
+    const int width = image.width();
+    const int height = image.height();
+    int margin_x = 0;
+    int margin_y = 0;
+    for (const auto& [dx, dy, weight] : taps) {
+      margin_x = std::max(margin_x, std::abs(dx));
+      margin_y = std::max(margin_y, std::abs(dy));
+    }
+
+    // padded(x, y) = image(x - margin_x, y - margin_y) with wrapping, so that
+    // taps are plain offsets into it.
+    Image padded(width + 2 * margin_x, height + 2 * margin_y);
+    parallel_for(0, padded.height(), [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        int source_y = ((y - margin_y) % height + height) % height;
+        for (int x = 0; x < padded.width(); ++x) {
+          padded(x, y) = image(((x - margin_x) % width + width) % width,
+                               source_y);
+        }
+      }
+    });
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        float* out = reinterpret_cast<float*>(&image(0, y));
+        std::fill(out, out + 3 * width, 0.f);
+        for (const auto& [dx, dy, weight] : taps) {
+          const float* in = reinterpret_cast<const float*>(
+              &padded(margin_x - dx, y + margin_y - dy));
+          for (int i = 0; i < 3 * width; ++i) {
+            out[i] += weight * in[i];
+          }
+        }
+      }
+    });
+  }
+
+  // Nanoseconds per unit of work of each way to convolve, as measured by
+  // convolution_benchmark on one core. Only their ratios matter.
+  // Per pixel and log2(pixels), including transforming the filter.
+  constexpr double kFFTCost = 4.5;
+  // Per pixel and tap of the row and column kernels.
+  constexpr double kSeparableCost = 2.1;
+  // Per pixel and tap.
+  constexpr double kDirectCost = 1.6;
+
+  // How Convolve runs a filter: whichever of ConvolveFFT, ConvolveSeparable
+  // and ConvolveDirect the costs above make the cheapest.
+  struct ConvolutionPlan {
+    enum Method { FFT, SEPARABLE, DIRECT };
+
+    Method method = FFT;
+    // The kernels of ConvolveSeparable, if the filter is separable.
+    std::vector<float> row, column;
+    // The non-zero taps of the filter, if there are few enough to be worth
+    // listing.
+    std::vector<std::tuple<int, int, float>> taps;
+    double fft_cost = 0, separable_cost = 0, direct_cost = 0;
+  };
+
+  // Taps smaller than this fraction of the largest one are left out of
+  // ConvolveSeparable and ConvolveDirect, as floats could not add them to it.
+  constexpr float kNegligibleTap = 1e-7;
+
+  inline ConvolutionPlan PlanConvolution(const ComplexArray2D& filter) {
+    const int width = filter.width();
+    const int height = filter.height();
+    const double pixels = double(width) * height;
+    ConvolutionPlan res;
+    // Bluestein sizes cost a few times more (see fft.h).
+    res.fft_cost = kFFTCost * pixels * log2(pixels) *
+                   (fft::Plan::isFast(width) ? 1 : 4) *
+                   (fft::Plan::isFast(height) ? 1 : 4);
+    res.separable_cost = res.direct_cost = INFINITY;
+
+    float max_value = 0;
+    int max_x = 0, max_y = 0;
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const fft::Complex& value = filter(x, y);
+        if (value.imag() != 0) {
+          return res;
+        }
+        if (std::abs(value.real()) > max_value) {
+          max_value = std::abs(value.real());
+          max_x = x;
+          max_y = y;
+        }
+      }
+    }
+    if (max_value == 0) {
+      return res;
+    }
+    const float negligible = kNegligibleTap * max_value;
+    // Circular offsets, in [-size / 2, size / 2).
+    auto offset = [](int i, int size) {
+      return (i + size / 2) % size - size / 2;
+    };
+
+    int num_taps = 0;
+    for (int i = 0; i < filter.size(); ++i) {
+      num_taps += std::abs(filter(i).real()) > negligible;
     }
+    res.direct_cost = kDirectCost * pixels * num_taps;
+    if (res.direct_cost < res.fft_cost) {
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          if (std::abs(filter(x, y).real()) > negligible) {
+            res.taps.emplace_back(offset(x, width), offset(y, height),
+                                  filter(x, y).real());
+          }
+        }
+      }
+    }
+
+    // filter(x, y) = filter(x, max_y) * filter(max_x, y) / filter(max_x, max_y)
+    // if it is separable, up to float rounding.
+    const float pivot = filter(max_x, max_y).real();
+    bool separable = true;
+    for (int y = 0; y < height && separable; ++y) {
+      const float column_value = filter(max_x, y).real() / pivot;
+      for (int x = 0; x < width; ++x) {
+        float expected = filter(x, max_y).real() * column_value;
+        if (std::abs(filter(x, y).real() - expected) > 1e-5 * max_value) {
+          separable = false;
+          break;
+        }
+      }
+    }
+    if (separable) {
+      // Kernels of odd sizes around offset 0, without their negligible ends.
+      // at(i) * scale is the filter value along the pivot's row or column.
+      auto kernel = [&](int size, const std::function<float(int)>& at,
+                        float scale) {
+        int radius = 0;
+        for (int i = 0; i < size; ++i) {
+          if (std::abs(at(i) * scale) > negligible) {
+            radius = std::max(radius, std::abs(offset(i, size)));
+          }
+        }
+        std::vector<float> res(2 * radius + 1);
+        for (int i = 0; i < size; ++i) {
+          if (std::abs(offset(i, size)) <= radius) {
+            res[offset(i, size) + radius] = at(i);
+          }
+        }
+        return res;
+      };
+      res.row = kernel(
+          width, [&](int x) { return filter(x, max_y).real(); }, 1);
+      res.column = kernel(
+          height, [&](int y) { return filter(max_x, y).real() / pivot; },
+          pivot);
+      res.separable_cost =
+          kSeparableCost * pixels * (res.row.size() + res.column.size());
+    }
+
+    if (res.separable_cost < std::min(res.fft_cost, res.direct_cost)) {
+      res.method = ConvolutionPlan::SEPARABLE;
+    } else if (res.direct_cost < res.fft_cost) {
+      res.method = ConvolutionPlan::DIRECT;
+    }
+    return res;
+  }
+
+  // Circular convolution of each channel with `filter`, centered at (0, 0).
+  inline void Convolve(Image& image, const ComplexArray2D& filter) {
+    ConvolutionPlan plan = PlanConvolution(filter);
+    switch (plan.method) {
+      case ConvolutionPlan::SEPARABLE:
+        ConvolveSeparable(image, plan.row, plan.column);
+        break;
+      case ConvolutionPlan::DIRECT:
+        ConvolveDirect(image, plan.taps);
+        break;
+      default:
+        ConvolveFFT(image, filter);
+    }
+  }
+
+  // Average of each 2x2 block, as a (width + 1) / 2 x (height + 1) / 2 image.
+  // Pixels past the border count as black.
+  inline Image Downsample(const Image& image) {
+    const int width = image.width();
+    const int height = image.height();
+    Image res((width + 1) / 2, (height + 1) / 2);
+    parallel_for(0, res.height(), [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        const int rows = std::min(2, height - 2 * y);
+        for (int x = 0; x < res.width(); ++x) {
+          const int columns = std::min(2, width - 2 * x);
+          Color sum;
+          for (int dy = 0; dy < rows; ++dy) {
+            for (int dx = 0; dx < columns; ++dx) {
+              sum += image(2 * x + dx, 2 * y + dy);
+            }
+          }
+          res(x, y) = sum * 0.25;
+        }
+      }
+    });
+    return res;
+  }
+
+  // Bilinear resampling to width x height, where each pixel of `image` covers
+  // a 2x2 block of the result, as in Downsample.
+  inline Image Upsample(const Image& image, int width, int height) {
+    const int max_x = image.width() - 1;
+    const int max_y = image.height() - 1;
+    std::vector<int> x0(width);
+    std::vector<float> fx(width);
+    for (int x = 0; x < width; ++x) {
+      float sx = std::clamp(0.5f * x - 0.25f, 0.f, float(max_x));
+      x0[x] = std::min(int(sx), std::max(max_x - 1, 0));
+      fx[x] = sx - x0[x];
+    }
+    Image res(width, height);
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        float sy = std::clamp(0.5f * y - 0.25f, 0.f, float(max_y));
+        int y0 = std::min(int(sy), std::max(max_y - 1, 0));
+        int y1 = std::min(y0 + 1, max_y);
+        float fy = sy - y0;
+        for (int x = 0; x < width; ++x) {
+          int x1 = std::min(x0[x] + 1, max_x);
+          Color top = image(x0[x], y0) * (1 - fx[x]) + image(x1, y0) * fx[x];
+          Color bottom = image(x0[x], y1) * (1 - fx[x]) + image(x1, y1) * fx[x];
+          res(x, y) = top * (1 - fy) + bottom * fy;
+        }
+      }
+    });
+    return res;
+  }
+
+  // Separable [1 4 6 4 1] / 16 blur, black past the border. Rows are handled
+  // as floats, with neighbouring pixels 3 floats apart.
+  inline void BinomialBlur(Image& image) {
+    const int width = image.width();
+    const int height = image.height();
+    const float weights[5] = {1 / 16., 4 / 16., 6 / 16., 4 / 16., 1 / 16.};
+    Image rows(width, height);
+    parallel_for(0, height, [&](int min, int max) {
+      // The row with 2 black pixels on each side.
+      std::vector<float> padded(3 * (width + 4));
+      for (int y = min; y < max; ++y) {
+        const float* in = reinterpret_cast<const float*>(&image(0, y));
+        std::copy(in, in + 3 * width, &padded[6]);
+        float* out = reinterpret_cast<float*>(&rows(0, y));
+        for (int i = 0; i < 3 * width; ++i) {
+          out[i] = weights[0] * padded[i] + weights[1] * padded[i + 3] +
+                   weights[2] * padded[i + 6] + weights[3] * padded[i + 9] +
+                   weights[4] * padded[i + 12];
+        }
+      }
+    });
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        float* out = reinterpret_cast<float*>(&image(0, y));
+        std::fill(out, out + 3 * width, 0.f);
+        for (int dy = std::max(-2, -y); dy <= std::min(2, height - 1 - y);
+             ++dy) {
+          const float* in = reinterpret_cast<const float*>(&rows(0, y + dy));
+          for (int i = 0; i < 3 * width; ++i) {
+            out[i] += weights[dy + 2] * in[i];
+          }
+        }
+      }
+    });
+  }
+
+  // Adds the sum of weight * image(x + dx, y + dy) over all (dx, dy, weight) in
+  // `taps` to res(x, y), with bilinear interpolation for fractional offsets.
+  // Pixels past the border count as black.
+  inline void AddTaps(const Image& image,
+                      const std::vector<std::tuple<float, float, float>>& taps,
+                      Image* res) {
+    struct Corners {
+      int dx, dy;
+      float w00, w10, w01, w11;
+    };
+    std::vector<Corners> corners;
+    int margin = 1;
+    for (const auto& [x, y, weight] : taps) {
+      int dx = floor(x);
+      int dy = floor(y);
+      float fx = x - dx;
+      float fy = y - dy;
+      corners.push_back({dx, dy, weight * (1 - fx) * (1 - fy),
+                         weight * fx * (1 - fy), weight * (1 - fx) * fy,
+                         weight * fx * fy});
+      margin = std::max(margin, std::max(std::abs(dx), std::abs(dy)) + 1);
+    }
+
+    // A copy with a black margin wide enough for every tap, so that taps are
+    // plain offsets into it.
+    const int width = image.width();
+    const int height = image.height();
+    Image padded(width + 2 * margin, height + 2 * margin);
+    const int pitch = 3 * padded.width();
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        std::copy(&image(0, y), &image(0, y) + width,
+                  &padded(margin, y + margin));
+      }
+    });
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        float* out = reinterpret_cast<float*>(&(*res)(0, y));
+        const float* center =
+            reinterpret_cast<const float*>(&padded(margin, y + margin));
+        for (const Corners& c : corners) {
+          const float* top = center + c.dy * pitch + 3 * c.dx;
+          const float* bottom = top + pitch;
+          for (int i = 0; i < 3 * width; ++i) {
+            out[i] += c.w00 * top[i] + c.w10 * top[i + 3] +
+                      c.w01 * bottom[i] + c.w11 * bottom[i + 3];
+          }
+        }
+      }
+    });
+  }
+
+  // Approximates convolving with Bloom(2 * width, 2 * height) on the image
+  // padded to twice its size (so light leaving the frame is lost), in time
+  // linear in the number of pixels. Only the part of each channel above
+  // `threshold` is bloomed; the rest is kept as is.
+  //
+  // Bloom is 1/4 Id + 1/4 Ray + 1/2 Blur. Blur falls off as 1/r^2, which puts
+  // the same energy in every octave of distance [2^k, 2^(k+1)): it becomes a
+  // BinomialBlur (sigma ~ 2^k) of each level k of a mip chain, composited
+  // upward with Upsample. Ray's spokes also hold the same energy per octave;
+  // level k samples them at distances [4, 8) * 2^k, so streaks widen with the
+  // distance as Ray's wedges do.
+  inline void PyramidBloom(Image& image, float threshold = 0, int spokes = 8,
+                           float rotation = (2 * M_PI) / 100) {
+    const int width = image.width();
+    const int height = image.height();
+
+    // Shares of Bloom: Blur has 1 / (1 + pi * ln(1 + r^2)) of its energy at
+    // distance 0 when it reaches r pixels away, Ray has none there.
+    std::vector<Image> levels;
+    levels.emplace_back(width, height);
+    levels.reserve(2 + log2(std::max(width, height)));
+    while (std::max(levels.back().width(), levels.back().height()) > 2) {
+      levels.emplace_back((levels.back().width() + 1) / 2,
+                          (levels.back().height() + 1) / 2);
+    }
+    const int num_levels = levels.size();
+    // Ray covers [2, 8) at level 0, then [4, 8) * 2^k below the image size.
+    const int num_streak_levels = std::max(0, num_levels - 2);
+    const int num_bands = num_streak_levels + (num_streak_levels > 0);
+    const float radius = std::max(width, height);
+    const float blur_center = 1 / (1 + M_PI * log(1 + radius * radius));
+    const float blur_weight = 0.5 * (1 - blur_center) / num_levels;
+    const float id_weight =
+        0.25 + 0.5 * blur_center + (num_bands == 0 ? 0.25 : 0);
+
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        for (int x = 0; x < width; ++x) {
+          Color& color = image(x, y);
+          Color bright(std::max(color.r - threshold, 0.f),
+                       std::max(color.g - threshold, 0.f),
+                       std::max(color.b - threshold, 0.f));
+          color += bright * (id_weight - 1);
+          levels[0](x, y) = bright;
+        }
+      }
+    });
+    for (int k = 1; k < num_levels; ++k) {
+      levels[k] = Downsample(levels[k - 1]);
+    }
+
+    // Spokes through the center, as angles in [-pi / 2, pi / 2): Ray tests
+    // atan(dy / dx), so opposite spokes are always both there.
+    std::vector<float> angles;
+    const float arc = (2 * M_PI) / spokes;
+    for (int i = 0; i < spokes; ++i) {
+      float angle =
+          pos_fmod(arc / 2 - rotation + i * arc + M_PI / 2, M_PI) - M_PI / 2;
+      if (std::none_of(angles.begin(), angles.end(), [angle](float other) {
+            return std::abs(other - angle) < 1e-4;
+          })) {
+        angles.push_back(angle);
+      }
+    }
+    auto streak_taps = [&](std::initializer_list<float> distances) {
+      const float weight = 0.25 / (num_bands * angles.size() * 4);
+      std::vector<std::tuple<float, float, float>> res;
+      for (float angle : angles) {
+        for (float distance : distances) {
+          for (float sign : {-1, 1}) {
+            res.emplace_back(sign * distance * cos(angle),
+                             sign * distance * sin(angle), weight);
+          }
+        }
+      }
+      return res;
+    };
+
+    Image composite(levels.back().width(), levels.back().height());
+    for (int k = num_levels - 1; k >= 0; --k) {
+      Image& level = levels[k];
+      if (k < num_levels - 1) {
+        composite = Upsample(composite, level.width(), level.height());
+      }
+      if (k < num_streak_levels) {
+        AddTaps(level, k == 0 ? streak_taps({2, 3, 5, 7}) : streak_taps({5, 7}),
+                &composite);
+      }
+      BinomialBlur(level);
+      parallel_for(0, level.height(), [&](int min, int max) {
+        for (int y = min; y < max; ++y) {
+          for (int x = 0; x < level.width(); ++x) {
+            composite(x, y) += level(x, y) * blur_weight;
+          }
+        }
+      });
+    }
+
+    parallel_for(0, height, [&](int min, int max) {
+      for (int y = min; y < max; ++y) {
+        for (int x = 0; x < width; ++x) {
+          image(x, y) += composite(x, y);
+        }
+      }
+    });
   }
 };
 
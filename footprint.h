@@ -0,0 +1,34 @@
+/***
+ * Pixel footprint of the point being evaluated, for level of detail.
+ * Usage:
+ * #include "footprint.h"
+ * footprint::set(ray.footprint());  // In the renderer, before evaluating.
+ * float radius = footprint::get();   // In an SDF or a colorizer.
+ *
+ * The footprint is the radius of the pixel's cone at the evaluated point, in
+ * world units. SDFs and colorizers only get the point, so the renderer stores
+ * it per thread. 0, the default (e.g. when baking caches or in tests), asks
+ * for full detail.
+ ***/
+
+#ifndef FOOTPRINT_H
+#define FOOTPRINT_H
+
+namespace footprint {
+
+inline float& current() {
+  static thread_local float radius = 0;
+  return radius;
+}
+
+inline float get() {
+  return current();
+}
+
+inline void set(float radius) {
+  current() = radius;
+}
+
+}  // namespace footprint
+
+#endif
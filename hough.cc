@@ -5,8 +5,8 @@
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
-#include <thread>
 #include <vector>
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
@@ -16,6 +16,7 @@
 #include "progress.h"
 #include "rand_utils.h"
 #include "range.h"
+#include "thread_pool.h"
 #include "vec3.h"
 
 ABSL_FLAG(std::string, image, "corner", "the name of the input image");
@@ -42,47 +43,68 @@ float edginess(Image& img, int x, int y) {
 
 Array2D<float> detect_edges(Image& image) {
   Array2D<float> res(image.width(), image.height());
-  for (int y = 1; y < image.height() - 1; ++y) {
-    for (int x = 1; x < image.width() - 1; ++x) {
-      res(x, y) = edginess(image, x, y);
-      // Color diff1 = image(x, y) - image(x - 1, y);
-      // Color diff2 = image(x, y) - image(x + 1, y);
-      // Color diff3 = image(x, y) - image(x, y - 1);
-      // Color diff4 = image(x, y) - image(x, y + 1);
-      // res(x, y) = energy(diff1) + energy(diff2) + energy(diff3) +
-      // energy(diff4);
+  parallel_for(1, image.height() - 1, [&](int begin, int end) {
+    for (int y = begin; y < end; ++y) {
+      for (int x = 1; x < image.width() - 1; ++x) {
+        res(x, y) = edginess(image, x, y);
+        // Color diff1 = image(x, y) - image(x - 1, y);
+        // Color diff2 = image(x, y) - image(x + 1, y);
+        // Color diff3 = image(x, y) - image(x, y - 1);
+        // Color diff4 = image(x, y) - image(x, y + 1);
+        // res(x, y) = energy(diff1) + energy(diff2) + energy(diff3) +
+        // energy(diff4);
+      }
     }
-  }
+  });
 
   return res;
 }
 
+struct EdgePoint {
+  float x, y, val;
+};
+
+// Each thread accumulates whole theta columns, so every cell still sums its
+// edge points in the same order.
 Array2D<float> hough_transform(Array2D<float>& edges) {
   float r_max = sqrt(2);
 
   Array2D<float> res(theta_res, r_res);
 
-  Progress progress(edges.height());
+  std::vector<EdgePoint> points;
   for (int yp = 0; yp < edges.height(); yp += skip) {
-    progress.update(yp);
     float y = interpolate(yp, Range(0, edges.height()), Range(0, 1));
     for (int xp = 0; xp < edges.width(); xp += skip) {
       float val = edges(xp, yp);
       if (val == 0) continue;
       float x = interpolate(xp, Range(0, edges.width()), Range(0, 1));
-      for (int thetap = 0; thetap < theta_res; ++thetap) {
-        float theta = interpolate(thetap, Range(0, theta_res), Range(0, M_PI));
-        float r = x * cos(theta) + y * sin(theta);
+      points.push_back({x, y, val});
+    }
+  }
+
+  Progress progress(theta_res);
+  std::mutex progress_mutex;
+  std::atomic<int> thetas_done = 0;
+  parallel_for(0, theta_res, [&](int begin, int end) {
+    for (int thetap = begin; thetap < end; ++thetap) {
+      float theta = interpolate(thetap, Range(0, theta_res), Range(0, M_PI));
+      for (const EdgePoint& point : points) {
+        float r = point.x * cos(theta) + point.y * sin(theta);
         int rp = interpolate(r, Range(0, r_max), Range(0, r_res));
         if (rp >= 0 && rp < r_res) {
           // TODO: hack! for some reason for r=0 this doesn't work...
           if (rp == 0) continue;
-          res(thetap, rp) += val;
+          res(thetap, rp) += point.val;
         }
       }
     }
-  }
-  progress.update(edges.height());
+    int done = thetas_done += end - begin;
+    std::unique_lock<std::mutex> lock(progress_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+      progress.update(done);
+    }
+  });
+  progress.update(theta_res);
   progress.done();
 
   return res;
@@ -179,13 +201,15 @@ Array2D<float> find_local_max(Array2D<float>& arr) {
   Array2D<float> res(arr.width(), arr.height());
 
   Progress progress(arr.width());
-  for (int y = 0; y < arr.height(); y++) {
-    for (int x = 0; x < arr.width(); x++) {
-      if (isLocalMax(arr, x, y)) {
-        res(x, y) = arr(x, y);
+  parallel_for(0, arr.height(), [&](int begin, int end) {
+    for (int y = begin; y < end; y++) {
+      for (int x = 0; x < arr.width(); x++) {
+        if (isLocalMax(arr, x, y)) {
+          res(x, y) = arr(x, y);
+        }
       }
     }
-  }
+  });
   progress.update(arr.width());
   progress.done();
 
@@ -197,8 +221,10 @@ Image floatArrayToImage(Array2D<float>& arr,
   float max = arr.max();
   arr /= max;
   Image image(arr.width(), arr.height());
-  for (int i = 0; i < arr.size(); ++i) {
-    image(i) = palette.color(arr(i));
+  const Palette compiled = palette.compiled();
+  // Row by row, as arr may have padded rows.
+  for (size_t y = 0; y < arr.height(); ++y) {
+    compiled.colors(&arr(0, y), arr.width(), &image(0, y));
   }
   return image;
 }
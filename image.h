@@ -7,8 +7,29 @@
 #include "logging.h"
 #include "math.h"
 #include "palette.h"
+#include "pixels.h"
 #include "rgb.h"
 
+template <>
+struct Array2DElement<Color> {
+  static constexpr uint32_t kId = 16;
+};
+
+template <>
+struct Array2DElement<Half3> {
+  static constexpr uint32_t kId = 17;
+};
+
+template <>
+struct Array2DElement<RGB9E5> {
+  static constexpr uint32_t kId = 18;
+};
+
+template <>
+struct Array2DElement<RGB> {
+  static constexpr uint32_t kId = 19;
+};
+
 class Image : public Array2D<Color> {
  public:
   Image(int width, int height) : Array2D<Color>(width, height) {}
@@ -17,6 +38,10 @@ class Image : public Array2D<Color> {
 
   Image(const Array2D<Color>&& arr) : Array2D<Color>(std::move(arr)) {}
 
+  template <class E,
+            std::enable_if_t<array2d_expression::kIsNode<E>, int> = 0>
+  Image(const E& expression) : Array2D<Color>(expression) {}
+
   enum Channel { RED, GREEN, BLUE };
 
   Array2D<float> getChannel(Channel channel) {
@@ -84,9 +109,10 @@ class Image : public Array2D<Color> {
     CHECK(fp != 0) << "cannot open file '" << filename << "'.";
     (void)fprintf(fp, "P6\n%d %d\n255\n", (int)width_, (int)height_);
 
-    for (int i = 0; i < size_; ++i) {
-      RGB rgb((*this)(i));
-      (void)fwrite(&rgb, 1, 3, fp);
+    std::vector<RGB> row(width_);
+    for (int y = 0; y < height_; ++y) {
+      pixels::pack(&(*this)(0, y), width_, row.data());
+      (void)fwrite(row.data(), 3, width_, fp);
     }
     (void)fclose(fp);
   }
@@ -98,10 +124,13 @@ class Image : public Array2D<Color> {
 
   static Image fromFloatArray(const Array2D<float>& arr,
                               const Palette& palette = Palette::RedHot()) {
-    float max = arr.max();
+    Array2D<float> normalized(arr);
+    normalized /= arr.max();
     Image image(arr.width(), arr.height());
-    for (int i = 0; i < arr.size(); ++i) {
-      image(i) = palette.color(arr(i) / max);
+    const Palette compiled = palette.compiled();
+    // Row by row, as arr may have padded rows.
+    for (size_t y = 0; y < arr.height(); ++y) {
+      compiled.colors(&normalized(0, y), arr.width(), &image(0, y));
     }
     return image;
   }
@@ -138,4 +167,32 @@ class Image : public Array2D<Color> {
   }
 };
 
+// Images stored as Half3, RGB9E5 or RGB pixels (see pixels.h), which take 2,
+// 3 and 4 times less memory than Image, for intermediate results and
+// snapshots.
+template <class Pixel>
+class PackedImage : public Array2D<Pixel> {
+ public:
+  PackedImage(int width, int height) : Array2D<Pixel>(width, height) {}
+
+  explicit PackedImage(const Image& image)
+      : Array2D<Pixel>(image.width(), image.height()) {
+    for (int y = 0; y < this->height(); ++y) {
+      pixels::pack(&image(0, y), this->width(), &(*this)(0, y));
+    }
+  }
+
+  Image unpack() const {
+    Image res(this->width(), this->height());
+    for (int y = 0; y < this->height(); ++y) {
+      pixels::unpack(&(*this)(0, y), this->width(), &res(0, y));
+    }
+    return res;
+  }
+};
+
+typedef PackedImage<Half3> HalfImage;
+typedef PackedImage<RGB9E5> RGB9E5Image;
+typedef PackedImage<RGB> Image8;
+
 #endif
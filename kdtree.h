@@ -3,6 +3,7 @@
 
 #include <vector>
 
+#include "arena.h"
 #include "vec3.h"
 #include "logging.h"
 #include "sdf.h"
@@ -15,6 +16,9 @@ class SpheresKDTree : public SDF {
   };
 
 public:
+  // Subtrees created by compile() are allocated in `arena` when it is given.
+  explicit SpheresKDTree(Arena* arena = 0) : arena(arena) {}
+
   void addChild(Sphere* child) {
       pivot.spheres.push_back(child);
   }
@@ -36,18 +40,25 @@ public:
 
   void addLeftChild(Sphere* s) {
       if (left == 0) {
-          left = new SpheresKDTree;
+          left = newSubtree();
       }
       left->pivot.spheres.push_back(s);
   }
 
   void addRightChild(Sphere* s) {
       if (right == 0) {
-          right = new SpheresKDTree;
+          right = newSubtree();
       }
       right->pivot.spheres.push_back(s);
   }
 
+  SpheresKDTree* newSubtree() {
+      if (arena != 0) {
+          return arena->make<SpheresKDTree>(arena);
+      }
+      return new SpheresKDTree;
+  }
+
   void compile() {
       // TODO: play with this number (10 seemed to work faster than 3).
       if (pivot.spheres.size() < 8) {
@@ -100,6 +111,20 @@ public:
       }
   }
 
+  AABB bounds() const {
+    AABB res = AABB::empty();
+    for (Sphere* sphere : pivot.spheres) {
+      res = res | sphere->bounds();
+    }
+    if (left != 0) {
+      res = res | left->bounds();
+    }
+    if (right != 0) {
+      res = res | right->bounds();
+    }
+    return res;
+  }
+
   SDFResult sdf(const vec3& v) const {
     SDF_COUNTERS(SpheresKDTree);
     // TODO: clean this constant.
@@ -129,6 +154,7 @@ public:
     return res;
   }
 private:
+  Arena* arena = 0;
   SpheresKDTree* left = 0;
   SpheresKDTree* right = 0;
   Pivot pivot;
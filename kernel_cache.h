@@ -0,0 +1,130 @@
+/***
+ * Cache of convolution kernels in the frequency domain.
+ * Usage:
+ * #include "kernel_cache.h"
+ * GlobalKernelCache::instance().setDirectory("/tmp/kernels");  // Optional.
+ * const Array2D<fft::Complex>& spectrum = GlobalKernelCache::instance().get(
+ *     "bloom_2048x2048", 2048, 2048,
+ *     []() { return filters::Bloom(2048, 2048); });
+ *
+ * get returns the fft2d of the kernel built by `make`, building it at most
+ * once per key and process. Keys must identify the filter, its parameters and
+ * its size. If a directory is set, spectra are also saved there as
+ * <key>.kernel and mapped into memory by later runs (see Array2D::map);
+ * files which do not hold a spectrum of the right size are rebuilt. Changing
+ * how a kernel is built requires a new key.
+ ***/
+
+#ifndef KERNEL_CACHE_H
+#define KERNEL_CACHE_H
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "array2d.h"
+#include "fft.h"
+#include "logging.h"
+#include "singleton.h"
+
+class KernelCache {
+ public:
+  typedef Array2D<fft::Complex> Spectrum;
+
+  // Empty to only cache in memory.
+  void setDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+  }
+
+  // The spectrum of the width x height kernel built by `make`. Kernels of
+  // different keys are built concurrently. If `make` throws, nothing is
+  // cached and the next call builds the kernel again.
+  const Spectrum& get(const std::string& key, int width, int height,
+                      const std::function<Spectrum()>& make) {
+    Entry* entry;
+    std::string directory;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::unique_ptr<Entry>& slot = entries_[key];
+      if (!slot) {
+        slot = std::make_unique<Entry>();
+      }
+      entry = slot.get();
+      directory = directory_;
+    }
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (entry->spectrum) {
+      return *entry->spectrum;
+    }
+    auto spectrum = std::make_unique<Spectrum>(0, 0);
+    std::string filename =
+        directory.empty() ? "" : directory + "/" + key + ".kernel";
+    if (filename.empty() || !load(filename, width, height, spectrum.get())) {
+      *spectrum = make();
+      CHECK(spectrum->width() == width && spectrum->height() == height)
+          << "kernel " << key << " is " << spectrum->width() << 'x'
+          << spectrum->height() << ", not " << width << 'x' << height;
+      fft::fft2d_mt(*spectrum);
+      if (!filename.empty()) {
+        save(filename, *spectrum);
+      }
+    }
+    entry->spectrum = std::move(spectrum);
+    std::lock_guard<std::mutex> size_lock(mutex_);
+    num_spectra_++;
+    return *entry->spectrum;
+  }
+
+  // The number of spectra built or loaded.
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_spectra_;
+  }
+
+ private:
+  // Maps the file if it holds a width x height spectrum.
+  static bool load(const std::string& filename, size_t width, size_t height,
+                   Spectrum* spectrum) {
+    size_t file_width, file_height;
+    if (!Spectrum::readDimensions(filename, &file_width, &file_height) ||
+        file_width != width || file_height != height) {
+      return false;
+    }
+    spectrum->map(filename);
+    return true;
+  }
+
+  // Writes to a temporary file first, so that concurrent runs never read a
+  // partial spectrum.
+  static void save(const std::string& filename, const Spectrum& spectrum) {
+    std::error_code error;
+    std::filesystem::create_directories(
+        std::filesystem::path(filename).parent_path(), error);
+    std::string tmp = filename + ".tmp" + std::to_string(getpid());
+    spectrum.serialize(tmp);
+    std::filesystem::rename(tmp, filename, error);
+  }
+
+  // Entries are never removed, so that references to their spectra stay
+  // valid. Their mutex is held while building the spectrum.
+  struct Entry {
+    std::mutex mutex;
+    std::unique_ptr<Spectrum> spectrum;
+  };
+
+  // Guards directory_, entries_ and num_spectra_, but not the entries.
+  mutable std::mutex mutex_;
+  std::string directory_;
+  std::map<std::string, std::unique_ptr<Entry>> entries_;
+  size_t num_spectra_ = 0;
+};
+
+SINGLETON(KernelCache, GlobalKernelCache);
+
+#endif
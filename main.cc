@@ -6,8 +6,8 @@
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <string>
-#include <thread>
 #include <vector>
 
 #include "absl/flags/flag.h"
@@ -16,9 +16,9 @@
 #include "fft.h"
 #include "filters.h"
 #include "image.h"
+#include "kernel_cache.h"
 #include "light.h"
 #include "mat4.h"
-#include "object_registry.h"
 #include "palette.h"
 #include "progress.h"
 #include "rand_utils.h"
@@ -26,68 +26,153 @@
 #include "ray.h"
 #include "renderer.h"
 #include "rendering_params.h"
+#include "scenes/scene_file.h"
 #include "scenes/scenes.h"
 #include "sdf.h"
+#include "sdf_optimizer.h"
+#include "thread_pool.h"
 #include "vec3.h"
 
 ABSL_FLAG(std::string, scene, "Spheres", "name of scene to load");
+ABSL_FLAG(std::string, scene_file, "",
+          "if set, load --scene from this (text or compiled) scene file");
+ABSL_FLAG(std::string, kernel_cache_dir, "",
+          "if set, save the transformed bloom kernels in this directory and "
+          "reuse them in later runs");
+ABSL_FLAG(std::string, bloom, "fft",
+          "post processing bloom: 'fft' convolves with filters::Bloom, "
+          "'pyramid' approximates it much faster (see filters::PyramidBloom)");
+ABSL_FLAG(std::string, snapshot_format, "float",
+          "pixels of the output/render<frame>.img snapshots: 'float' (Color), "
+          "or 'half' and 'rgb9e5' for 2 and 3 times smaller files (see "
+          "pixels.h)");
+ABSL_FLAG(bool, optimize_sdf, true,
+          "simplify the scene's SDF graph (see sdf_optimizer.h) before "
+          "rendering. Expensive objects are bounded either way");
 
-std::atomic<int> global_y = 0;
 Scene* scene = 0;
 Renderer renderer;
 
-void progress_thread() {
-  Progress progress(scene->rendering_params().height);
-  while (global_y < scene->rendering_params().height) {
-    progress.update(global_y);
-    usleep(1000 * 100);
-  }
-  progress.update(global_y);
-  progress.done();
-}
-
 DEFINE_COUNTER(rays);
 
-void render_thread(Image* image) {
-  int y = global_y++;
+void render_row(Image* image, int y) {
   int width = scene->rendering_params().width;
   int height = scene->rendering_params().height;
   int aa_factor = scene->rendering_params().aa_factor;
-  while (y < height) {
-    // std::cout << "Rendering line: " << y << std::endl;
-    for (int x = 0; x < width; ++x) {
-      Color color;
-      for (int dx = 0; dx < aa_factor; ++dx) {
-        for (int dy = 0; dy < aa_factor; ++dy) {
-          float x_dir = interpolate(x * aa_factor + dx,
-                                    Range(0, width * aa_factor), Range(-1, 1));
-          float y_dir = interpolate(y * aa_factor + dy,
-                                    Range(0, height * aa_factor), Range(1, -1));
-          float z_dir = scene->rendering_params().screen_z;
-          Ray ray(vec3(), vec3(x_dir, y_dir, z_dir).normalize());
-          COUNTER_INC(rays);
-
-          ray.origin = renderer.view_world_matrix() * ray.origin;
-          ray.direction = renderer.view_world_matrix().rotate(ray.direction);
-          color +=
-              renderer.shoot(ray, scene->rendering_params().reflection_depth);
-        }
+  for (int x = 0; x < width; ++x) {
+    Color color;
+    for (int dx = 0; dx < aa_factor; ++dx) {
+      for (int dy = 0; dy < aa_factor; ++dy) {
+        float x_dir = interpolate(x * aa_factor + dx,
+                                  Range(0, width * aa_factor), Range(-1, 1));
+        float y_dir = interpolate(y * aa_factor + dy,
+                                  Range(0, height * aa_factor), Range(1, -1));
+        float z_dir = scene->rendering_params().screen_z;
+        Ray ray(vec3(), vec3(x_dir, y_dir, z_dir).normalize());
+        // Half a (sub)pixel of the screen at distance screen_z.
+        ray.spread = 1 / (z_dir * width * aa_factor);
+        COUNTER_INC(rays);
+
+        ray.origin = renderer.view_world_matrix() * ray.origin;
+        ray.direction = renderer.view_world_matrix().rotate(ray.direction);
+        color +=
+            renderer.shoot(ray, scene->rendering_params().reflection_depth);
       }
-      (*image)(x, y) = color / (aa_factor * aa_factor);
     }
-    y = global_y++;
+    (*image)(x, y) = color / (aa_factor * aa_factor);
   }
 }
 
+// Renders rows one at a time on the global thread pool. Whichever thread
+// finishes a row updates the progress bar, unless another one is at it.
+void render(Image* image) {
+  const int height = scene->rendering_params().height;
+  Progress progress(height);
+  std::mutex progress_mutex;
+  std::atomic<int> rows_done = 0;
+  parallel_for(
+      0, height,
+      [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+          render_row(image, y);
+        }
+        int done = rows_done += end - begin;
+        std::unique_lock<std::mutex> lock(progress_mutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+          progress.update(done);
+        }
+      },
+      1);
+  progress.update(height);
+  progress.done();
+}
+
 std::string counter_filename(std::string basename, int count,
                              std::string suffix) {
   return basename + std::to_string(count) + suffix;
 }
 
+void save_snapshot_file(const Image& image, const std::string& filename) {
+  const std::string format = absl::GetFlag(FLAGS_snapshot_format);
+  if (format == "half") {
+    HalfImage(image).serialize(filename);
+  } else if (format == "rgb9e5") {
+    RGB9E5Image(image).serialize(filename);
+  } else {
+    image.serialize(filename);
+  }
+}
+
+// Reads snapshots in any of the formats of --snapshot_format.
+void load_snapshot_file(const std::string& filename, Image* image) {
+  size_t width, height;
+  if (HalfImage::readDimensions(filename, &width, &height)) {
+    HalfImage packed(0, 0);
+    packed.map(filename);
+    *image = packed.unpack();
+  } else if (RGB9E5Image::readDimensions(filename, &width, &height)) {
+    RGB9E5Image packed(0, 0);
+    packed.map(filename);
+    *image = packed.unpack();
+  } else {
+    image->map(filename);
+  }
+}
+
 int main(int argc, char** argv) {
   absl::ParseCommandLine(argc, argv);
+  if (!absl::GetFlag(FLAGS_scene_file).empty()) {
+    scenes::RegisterScene(absl::GetFlag(FLAGS_scene), []() {
+      Scene* loaded = scene_file::LoadSceneFile(
+          absl::GetFlag(FLAGS_scene_file), absl::GetFlag(FLAGS_scene));
+      CHECK(loaded != 0) << "no scene '" << absl::GetFlag(FLAGS_scene)
+                         << "' in " << absl::GetFlag(FLAGS_scene_file);
+      return loaded;
+    });
+  }
   scene = scenes::GetScene(absl::GetFlag(FLAGS_scene));
+  {
+    // Scenes such as Stars rely on addBounds to bound their expensive
+    // objects, so it runs even without the other rewrites.
+    SDFOptimizer optimizer(scene->modifiable_arena());
+    if (absl::GetFlag(FLAGS_optimize_sdf)) {
+      optimizer.optimize(scene->modifiable_root());
+    }
+    optimizer.addBounds(scene->modifiable_root());
+    if (absl::GetFlag(FLAGS_optimize_sdf)) {
+      std::cout << optimizer.str();
+    }
+  }
   renderer.setScene(scene);
+  CHECK(absl::GetFlag(FLAGS_bloom) == "fft" ||
+        absl::GetFlag(FLAGS_bloom) == "pyramid")
+      << "unknown --bloom " << absl::GetFlag(FLAGS_bloom);
+  CHECK(absl::GetFlag(FLAGS_snapshot_format) == "float" ||
+        absl::GetFlag(FLAGS_snapshot_format) == "half" ||
+        absl::GetFlag(FLAGS_snapshot_format) == "rgb9e5")
+      << "unknown --snapshot_format " << absl::GetFlag(FLAGS_snapshot_format);
+  GlobalKernelCache::instance().setDirectory(
+      absl::GetFlag(FLAGS_kernel_cache_dir));
 
   bool apply_post_processing = true;
   bool double_image_before_convolution = true;
@@ -99,7 +184,7 @@ int main(int argc, char** argv) {
                           scene->rendering_params().camera_settings.target,
                           scene->rendering_params().camera_settings.up);
 
-  std::cout << "Total SDFs: " << registry::registry.numObjects() << std::endl;
+  std::cout << scene->arena().str();
   std::cout << "Total lights: " << scene->lights().size() << std::endl;
   std::cout << "Total masses: " << scene->masses().size() << std::endl;
 
@@ -111,7 +196,8 @@ int main(int argc, char** argv) {
   for (int frame = 0; frame < scene->rendering_params().animation_params.frames;
        ++frame) {
     if (resume_from_snapshot) {
-      img.deserialize(counter_filename("output/render", frame, ".img"));
+      load_snapshot_file(counter_filename("output/render", frame, ".img"),
+                         &img);
     } else {
       // float animation_fraction = float(frame) /
       // scene->rendering_params().animation_params.frames; vec3 eye_movement =
@@ -122,37 +208,32 @@ int main(int argc, char** argv) {
           scene->rendering_params().camera_settings.eye_pos + eye_movement,
           scene->rendering_params().camera_settings.target,
           scene->rendering_params().camera_settings.up);
-      global_y = 0;
-      const int num_threads = std::thread::hardware_concurrency();
       std::cout << "Rendering frame " << frame << "/"
                 << scene->rendering_params().animation_params.frames << " with "
-                << num_threads << " threads..." << std::endl;
-      std::vector<std::thread> threads;
-      for (int i = 0; i < num_threads; ++i) {
-        threads.push_back(std::thread(render_thread, &img));
-      }
-      progress_thread();
-      for (std::thread& thread : threads) {
-        thread.join();
-      }
+                << GlobalThreadPool::instance().numThreads() << " threads..."
+                << std::endl;
+      render(&img);
 
       if (save_snapshot) {
-        img.serialize(counter_filename("output/render", frame, ".img"));
+        save_snapshot_file(img,
+                           counter_filename("output/render", frame, ".img"));
       }
     }
 
     if (apply_post_processing) {
       std::cout << "Applying post processing effects..." << std::endl;
-      if (double_image_before_convolution) {
+      if (absl::GetFlag(FLAGS_bloom) == "pyramid") {
+        filters::PyramidBloom(img);
+      } else if (double_image_before_convolution) {
         img = img.resize(img.width() * 2, img.height() * 2);
-        filters::Convolve(img,
-                          filters::Bloom(scene->rendering_params().width * 2,
-                                         scene->rendering_params().height * 2));
+        filters::ConvolveSpectrum(
+            img, filters::BloomSpectrum(scene->rendering_params().width * 2,
+                                        scene->rendering_params().height * 2));
         img = img.resize(img.width() / 2, img.height() / 2);
       } else {
-        filters::Convolve(img,
-                          filters::Bloom(scene->rendering_params().width,
-                                         scene->rendering_params().height));
+        filters::ConvolveSpectrum(
+            img, filters::BloomSpectrum(scene->rendering_params().width,
+                                        scene->rendering_params().height));
       }
     }
     img.save(counter_filename("output/output", frame, ".ppm").c_str());
@@ -0,0 +1,76 @@
+#include "noise.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include "perlin_noise.h"
+#include "simplex_noise.h"
+
+const Noise* Noise::get(Type type) {
+  static const PerlinNoise perlin;
+  static const SimplexNoise simplex;
+  switch (type) {
+    case PERLIN:
+      return &perlin;
+    case SIMPLEX:
+      return &simplex;
+  }
+  return &perlin;
+}
+
+float Noise::fbm(float x, float y, float z, int octaves,
+                 float detail) const {
+  if (octaves <= 1) {
+    return noise(x, y, z);
+  }
+  detail = std::clamp(detail, 1.0f, float(octaves));
+  // Sum of the amplitudes of all octaves.
+  float total = 2 * (1 - std::ldexp(1.0f, -octaves));
+  float res = 0;
+  float amplitude = 1;
+  for (int i = 0; i < detail; ++i) {
+    float weight = amplitude * std::min(1.0f, detail - i);
+    res += weight * (2 * noise(x, y, z) - 1);
+    x *= 2;
+    y *= 2;
+    z *= 2;
+    amplitude /= 2;
+  }
+  return (res / total + 1) / 2;
+}
+
+float Noise::detail(float footprint, int octaves) {
+  if (footprint <= 0) {
+    return octaves;
+  }
+  // Octave i has features of size 2^-i, which need a footprint of at most
+  // half that.
+  return std::clamp(-std::log2(footprint), 1.0f, float(octaves));
+}
+
+void Noise::referencePermutation(uint8_t* p) {
+  static const uint8_t reference[256] = {
+    151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,
+    8,99,37,240,21,10,23,190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,
+    35,11,32,57,177,33,88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,
+    134,139,48,27,166,77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,
+    55,46,245,40,244,102,143,54, 65,25,63,161,1,216,80,73,209,76,132,187,208, 89,
+    18,169,200,196,135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,
+    250,124,123,5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,
+    189,28,42,223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167,
+    43,172,9,129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,
+    97,228,251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,
+    107,49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
+    138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180 };
+  std::copy_n(reference, 256, p);
+  std::copy_n(reference, 256, p + 256);
+}
+
+void Noise::randomPermutation(unsigned int seed, uint8_t* p) {
+  std::iota(p, p + 256, 0);
+  std::default_random_engine engine(seed);
+  std::shuffle(p, p + 256, engine);
+  std::copy_n(p, 256, p + 256);
+}
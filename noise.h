@@ -0,0 +1,51 @@
+/***
+ * Common interface of the gradient noise implementations.
+ * Usage:
+ * #include "noise.h"
+ * const Noise* noise = Noise::get(Noise::SIMPLEX);
+ * float value = noise->noise(x, y, z);  // In [0, 1].
+ * float rough = noise->fbm(x, y, z, 5, Noise::detail(footprint, 5));
+ *
+ * PERLIN is classic Perlin noise (perlin_noise.h), which blends the gradients
+ * of the 8 corners of a cube. SIMPLEX (simplex_noise.h) sums the gradients of
+ * the 4 corners of a tetrahedron and is about 3x cheaper, at the cost of a
+ * different look: more contrast, and no axis aligned artifacts.
+ ***/
+
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <stdint.h>
+
+class Noise {
+ public:
+  enum Type { PERLIN, SIMPLEX };
+
+  virtual ~Noise() {}
+
+  // Shared instance of the given type, with the reference permutation.
+  static const Noise* get(Type type);
+
+  // Noise value in [0, 1]. For 2D images z can have any value.
+  virtual float noise(float x, float y, float z) const = 0;
+
+  // Fractal Brownian motion in [0, 1]: the sum of `octaves` layers of noise,
+  // each with twice the frequency and half the amplitude of the previous one.
+  // Only the first `detail` octaves are evaluated, the last one faded in by
+  // the fractional part, and the others are replaced by their mean. Lower
+  // detail thus blurs the noise without shifting it. Same as noise() for a
+  // single octave.
+  float fbm(float x, float y, float z, int octaves, float detail) const;
+
+  // Number of octaves worth evaluating for a sample covering a sphere of
+  // radius `footprint`, in noise coordinates. Finer octaves would alias.
+  static float detail(float footprint, int octaves);
+
+ protected:
+  // Fill p[0, 512) with a permutation of [0, 256), twice so that p[i + j]
+  // never wraps: Ken Perlin's reference one, or a random one.
+  static void referencePermutation(uint8_t* p);
+  static void randomPermutation(unsigned int seed, uint8_t* p);
+};
+
+#endif
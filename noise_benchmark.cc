@@ -0,0 +1,182 @@
+// Speed and quality of the noise implementations.
+// Usage: noise_benchmark [--n=1048576] [--repeat=10] [--octaves=4]
+//
+// Compares the single point, batched scalar and batched SIMD versions of
+// PerlinNoise::noise, then Perlin and simplex noise on the surfaces of the
+// Stars scene's sun and Earth (see scenes/stars.cc), and finally baked noise
+// textures.
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "color.h"
+#include "colorizer.h"
+#include "noise.h"
+#include "noise_texture.h"
+#include "perlin_noise.h"
+#include "rand_utils.h"
+#include "vec3.h"
+
+ABSL_FLAG(int, n, 1 << 20, "Number of points per run");
+ABSL_FLAG(int, repeat, 10, "Number of runs");
+ABSL_FLAG(int, octaves, 4, "Number of octaves of the fractal noise");
+
+float sum = 0;
+
+// Returns the time per point in nanoseconds.
+template <class F>
+double benchmark(int n, const F& f) {
+  int repeat = absl::GetFlag(FLAGS_repeat);
+  f();  // Warm up.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (double(n) * repeat);
+}
+
+void benchmarkBatch(int n) {
+  std::vector<float> x(n), y(n), z(n), res(n);
+  for (int i = 0; i < n; ++i) {
+    x[i] = rand_range(-100, 100);
+    y[i] = rand_range(-100, 100);
+    z[i] = rand_range(-100, 100);
+  }
+  PerlinNoise perlin;
+  std::cout << "Perlin noise, ns/point:" << std::endl;
+  std::cout << "  single point: " << benchmark(n, [&]() {
+    for (int i = 0; i < n; ++i) {
+      res[i] = perlin.noise(x[i], y[i], z[i]);
+    }
+    sum += res[n / 2];
+  }) << std::endl;
+  std::cout << "  batch scalar: " << benchmark(n, [&]() {
+    perlin.noiseScalar(x.data(), y.data(), z.data(), res.data(), n);
+    sum += res[n / 2];
+  }) << std::endl;
+  std::cout << "  batch: " << benchmark(n, [&]() {
+    perlin.noise(x.data(), y.data(), z.data(), res.data(), n);
+    sum += res[n / 2];
+  }) << std::endl;
+}
+
+struct Surface {
+  std::string name;
+  float radius;
+  // Scale of the noise coordinates.
+  float scale;
+};
+
+void benchmarkSurface(const Surface& surface, int n) {
+  // Noise coordinates of random points on the surface.
+  std::vector<vec3> points;
+  for (int i = 0; i < n; ++i) {
+    points.push_back(vec3::random() * surface.radius * surface.scale);
+  }
+  const int octaves = absl::GetFlag(FLAGS_octaves);
+  std::cout << surface.name << ", noise scale " << surface.scale << ':'
+            << std::endl;
+  for (Noise::Type type : {Noise::PERLIN, Noise::SIMPLEX}) {
+    const Noise* noise = Noise::get(type);
+    double single_ns = benchmark(n, [&]() {
+      for (const vec3& v : points) {
+        sum += noise->noise(v.x, v.y, v.z);
+      }
+    });
+    double fbm_ns = benchmark(n, [&]() {
+      for (const vec3& v : points) {
+        sum += noise->fbm(v.x, v.y, v.z, octaves, octaves);
+      }
+    });
+    // Distribution of the values, and mean slope along the surface.
+    const float h = 0.01;
+    double mean = 0, mean2 = 0, slope = 0;
+    float min = 1, max = 0;
+    for (const vec3& v : points) {
+      float value = noise->fbm(v.x, v.y, v.z, octaves, octaves);
+      mean += value;
+      mean2 += value * value;
+      min = std::min(min, value);
+      max = std::max(max, value);
+      vec3 u = v + v.cross(vec3::random()).normalize() * h;
+      slope += std::abs(noise->fbm(u.x, u.y, u.z, octaves, octaves) - value) /
+               h;
+    }
+    mean /= n;
+    std::cout << "  " << (type == Noise::PERLIN ? "perlin" : "simplex")
+              << ": " << single_ns << " ns/point, " << fbm_ns
+              << " ns/point with " << octaves << " octaves; mean " << mean
+              << ", stddev " << sqrt(mean2 / n - mean * mean) << ", range ["
+              << min << ", " << max << "], mean slope " << slope / n
+              << std::endl;
+  }
+}
+
+void benchmarkTexture(int n) {
+  std::vector<vec3> points;
+  for (int i = 0; i < n; ++i) {
+    points.push_back(vec3::random() * 45);
+  }
+  PerlinNoise perlin;
+  std::cout << "Baked textures, period 8:" << std::endl;
+  for (int resolution : {16, 32, 64, 128}) {
+    NoiseTexture::Params params;
+    params.resolution = resolution;
+    params.period = 8;
+    NoiseTexture texture(perlin, params);
+    double ns = benchmark(n, [&]() {
+      for (const vec3& v : points) {
+        sum += texture.noise(v.x, v.y, v.z);
+      }
+    });
+    std::cout << "  resolution " << resolution << ": " << ns
+              << " ns/point, max error " << texture.maxError(n) << ", "
+              << texture.bytes() << " bytes" << std::endl;
+  }
+
+  // The sun's colorizer.
+  const int octaves = absl::GetFlag(FLAGS_octaves);
+  Palette palette({Color(0xD14009), Color(0xFC9601), Color(0xFFCC33),
+                   Color(0xFFE484), Color(0xFFFFFF)});
+  PerlinNoiseColorizer analytic(palette, 1, octaves);
+  PerlinNoiseColorizer baked(palette, 1, octaves);
+  NoiseTexture::Params params;
+  baked.bake(params);
+  double analytic_ns = benchmark(n, [&]() {
+    for (const vec3& v : points) {
+      sum += analytic.color(v).r;
+    }
+  });
+  double baked_ns = benchmark(n, [&]() {
+    for (const vec3& v : points) {
+      sum += baked.color(v).r;
+    }
+  });
+  std::cout << "Sun colorizer with " << octaves << " octaves: " << analytic_ns
+            << " ns/point analytic, " << baked_ns << " ns/point baked ("
+            << baked.baked()->str() << ')' << std::endl;
+}
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const int n = absl::GetFlag(FLAGS_n);
+  benchmarkBatch(n);
+  // Colorizers and deformations, as in Stars::Stars.
+  benchmarkSurface({"Sun surface", 45, 1}, n);
+  benchmarkSurface({"Sun deformation", 45, 2}, n);
+  benchmarkSurface({"Earth surface", 8, 0.8}, n);
+  benchmarkSurface({"Earth deformation", 8, 0.8}, n);
+  benchmarkTexture(n);
+  // Keeps the results alive.
+  std::cout << "checksum: " << sum << std::endl;
+  return 0;
+}
@@ -0,0 +1,135 @@
+/***
+ * Tileable 3D texture of baked Perlin noise.
+ * Usage:
+ * #include "noise_texture.h"
+ * NoiseTexture::Params params;
+ * params.resolution = 64;
+ * params.period = 8;
+ * NoiseTexture texture(PerlinNoise(), params);
+ * float value = texture.noise(x, y, z);
+ *
+ * The texture stores resolution^3 samples of PerlinNoise::periodicNoise over
+ * one period, and noise() interpolates them trilinearly, wrapping around. It
+ * implements Noise, so fbm() and levels of detail work the same as with the
+ * analytic noise. Octave i samples the texture 2^i times more sparsely, so
+ * fine octaves are less accurate.
+ ***/
+
+#ifndef NOISE_TEXTURE_H
+#define NOISE_TEXTURE_H
+
+#include <math.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "logging.h"
+#include "noise.h"
+#include "perlin_noise.h"
+#include "rand_utils.h"
+
+class NoiseTexture : public Noise {
+ public:
+  struct Params {
+    // Samples per period along each axis, a power of 2.
+    int resolution = 64;
+    // Noise lattice cells per period along each axis, at most 256.
+    int period = 8;
+  };
+
+  NoiseTexture(const PerlinNoise& perlin, const Params& params)
+      : perlin_(perlin), params_(params) {
+    const int n = params.resolution;
+    CHECK(n > 0 && (n & (n - 1)) == 0)
+        << "noise texture resolution must be a power of 2";
+    CHECK(params.period > 0 && params.period <= 256)
+        << "invalid noise texture period";
+    mask_ = n - 1;
+    scale_ = float(n) / params.period;
+    samples_.resize(size_t(n) * n * n);
+    for (int z = 0; z < n; ++z) {
+      for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+          samples_[index(x, y, z)] = perlin_.periodicNoise(
+              x / scale_, y / scale_, z / scale_, params.period);
+        }
+      }
+    }
+  }
+
+  float noise(float x, float y, float z) const override {
+    x *= scale_;
+    y *= scale_;
+    z *= scale_;
+    float fx = floorf(x);
+    float fy = floorf(y);
+    float fz = floorf(z);
+    int x0 = int(fx) & mask_;
+    int y0 = int(fy) & mask_;
+    int z0 = int(fz) & mask_;
+    int x1 = (x0 + 1) & mask_;
+    int y1 = (y0 + 1) & mask_;
+    int z1 = (z0 + 1) & mask_;
+    float tx = x - fx;
+    float ty = y - fy;
+    float tz = z - fz;
+    float c00 = lerp(tx, at(x0, y0, z0), at(x1, y0, z0));
+    float c10 = lerp(tx, at(x0, y1, z0), at(x1, y1, z0));
+    float c01 = lerp(tx, at(x0, y0, z1), at(x1, y0, z1));
+    float c11 = lerp(tx, at(x0, y1, z1), at(x1, y1, z1));
+    return lerp(tz, lerp(ty, c00, c10), lerp(ty, c01, c11));
+  }
+
+  // Largest difference from the analytic periodic noise over `n` random
+  // points.
+  float maxError(int n) const {
+    float res = 0;
+    for (int i = 0; i < n; ++i) {
+      float x = rand_range(0, params_.period);
+      float y = rand_range(0, params_.period);
+      float z = rand_range(0, params_.period);
+      res = std::max(res, std::abs(noise(x, y, z) -
+                                   perlin_.periodicNoise(x, y, z,
+                                                         params_.period)));
+    }
+    return res;
+  }
+
+  const Params& params() const {
+    return params_;
+  }
+
+  size_t bytes() const {
+    return samples_.size() * sizeof(float);
+  }
+
+  std::string str() const {
+    std::stringstream res;
+    res << "NoiseTexture: " << params_.resolution << "^3 samples over "
+        << params_.period << "^3 cells, " << bytes() << " bytes";
+    return res.str();
+  }
+
+ private:
+  static float lerp(float t, float a, float b) {
+    return a + t * (b - a);
+  }
+
+  size_t index(int x, int y, int z) const {
+    return (size_t(z) * params_.resolution + y) * params_.resolution + x;
+  }
+
+  float at(int x, int y, int z) const {
+    return samples_[index(x, y, z)];
+  }
+
+  PerlinNoise perlin_;
+  Params params_;
+  int mask_;
+  float scale_;
+  std::vector<float> samples_;
+};
+
+#endif
@@ -1,7 +1,36 @@
+/***
+ * Piecewise linear color maps.
+ * Usage:
+ * #include "palette.h"
+ * Palette palette = Palette::RedHot().compiled();
+ * Color c = palette.color(0.3);
+ * palette.colors(values, n, colors);  // Batch version.
+ *
+ * color() finds the keys around the value, with a binary search for large
+ * palettes. A compiled palette instead interpolates between kLutSize colors
+ * sampled evenly between the first and last keys. It is off by at most the
+ * change of color over 1/kLutSize of the palette's range, and only around
+ * keys. The batch version converts 8 values at a time with AVX2 when the
+ * palette is compiled and the CPU supports it.
+ *
+ * Keys must be added in increasing order.
+ ***/
+
 #ifndef PALETTE_H
 #define PALETTE_H
 
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PALETTE_X86
+#endif
+
 #include "color.h"
+#include "logging.h"
 #include "range.h"
 #include "rgb.h"
 
@@ -23,27 +52,97 @@ class Palette {
     }
   }
 
+  Palette(const std::vector<Color>& colors) {
+    double index = 0.0;
+    double step = 1.0 / (colors.size() - 1);
+    for (const Color& c : colors) {
+      addKey(Key(index, c));
+      index += step;
+    }
+  }
+
   struct Key {
     Key(double val, const Color& color) : val(val), color(color) {}
     double val;
     Color color;
   };
 
-  void addKey(const Key& key) { keys.push_back(key); }
+  static const int kLutSize = 1024;
+
+  void addKey(const Key& key) {
+    keys.push_back(key);
+    lut.clear();
+  }
 
   Color color(double val) const {
-    for (int i = 0; i < keys.size(); ++i) {
-      if (val < keys[i].val) {
-        if (i == 0) {
-          return keys[0].color;
-        }
-        const Key& a = keys[i - 1];
-        const Key& b = keys[i];
-        double alpha = interpolate(val, Range(a.val, b.val), Range());
-        return interpolate_colors(alpha, a.color, b.color);
-      }
+    if (!lut.empty()) {
+      return lutColor(val);
+    }
+    return exactColor(val);
+  }
+
+  Color exactColor(double val) const {
+    // The first key above val. Linear search is faster for a few keys.
+    auto above = [val](const Key& key) { return val < key.val; };
+    auto it = keys.size() <= 8
+                  ? std::find_if(keys.begin(), keys.end(), above)
+                  : std::upper_bound(keys.begin(), keys.end(), val,
+                                     [](double v, const Key& key) {
+                                       return v < key.val;
+                                     });
+    if (it == keys.begin()) {
+      return keys[0].color;
+    }
+    if (it == keys.end()) {
+      return keys[keys.size() - 1].color;
+    }
+    const Key& a = *(it - 1);
+    const Key& b = *it;
+    double alpha = interpolate(val, Range(a.val, b.val), Range());
+    return interpolate_colors(alpha, a.color, b.color);
+  }
+
+  // res[i] = color(vals[i]) for i in [0, n).
+  void colors(const float* vals, size_t n, Color* res) const {
+    size_t i = 0;
+#ifdef PALETTE_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (!lut.empty() && has_avx2) {
+      i = lutColorsAVX2(vals, n, res);
+    }
+#endif
+    for (; i < n; ++i) {
+      res[i] = color(vals[i]);
+    }
+  }
+
+  // Samples the palette for lookups, see above.
+  Palette& compile(int size = kLutSize) {
+    CHECK(size >= 2 && !keys.empty())
+        << "can't compile a palette of " << keys.size() << " keys into "
+        << size << " entries";
+    lut_size = size;
+    lut_min = keys[0].val;
+    float max = keys[keys.size() - 1].val;
+    lut_scale = max > lut_min ? (size - 1) / (max - lut_min) : 0;
+    lut.resize(3 * size);
+    for (int i = 0; i < size; ++i) {
+      Color c =
+          lut_scale > 0 ? exactColor(lut_min + i / lut_scale) : keys[0].color;
+      lut[i] = c.r;
+      lut[size + i] = c.g;
+      lut[2 * size + i] = c.b;
     }
-    return keys[keys.size() - 1].color;
+    return *this;
+  }
+
+  Palette compiled(int size = kLutSize) const {
+    Palette res = *this;
+    return res.compile(size);
+  }
+
+  bool isCompiled() const {
+    return !lut.empty();
   }
 
   static Palette RedHot() {
@@ -330,7 +429,62 @@ class Palette {
   }
 
  private:
+  Color lutColor(float val) const {
+    float t = (val - lut_min) * lut_scale;
+    // Also maps NaNs to the first color.
+    t = t > 0 ? std::min(t, float(lut_size - 1)) : 0;
+    int i = std::min(int(t), lut_size - 2);
+    t -= i;
+    const float* r = lut.data();
+    const float* g = r + lut_size;
+    const float* b = g + lut_size;
+    return Color(r[i] + (r[i + 1] - r[i]) * t, g[i] + (g[i + 1] - g[i]) * t,
+                 b[i] + (b[i + 1] - b[i]) * t);
+  }
+
+#ifdef PALETTE_X86
+  // Same as lutColor on 8 values at a time. Returns the number of values
+  // converted.
+  __attribute__((target("avx2")))
+  size_t lutColorsAVX2(const float* vals, size_t n, Color* res) const {
+    const __m256 min = _mm256_set1_ps(lut_min);
+    const __m256 scale = _mm256_set1_ps(lut_scale);
+    const __m256 last = _mm256_set1_ps(lut_size - 1);
+    const __m256i last_cell = _mm256_set1_epi32(lut_size - 2);
+    const __m256i one = _mm256_set1_epi32(1);
+    const float* channels[3] = {lut.data(), lut.data() + lut_size,
+                                lut.data() + 2 * lut_size};
+    alignas(32) float out[3][8];
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(vals + i), min),
+                               scale);
+      // max_ps returns its second operand for NaNs.
+      t = _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), last);
+      __m256i index = _mm256_min_epi32(_mm256_cvttps_epi32(t), last_cell);
+      t = _mm256_sub_ps(t, _mm256_cvtepi32_ps(index));
+      __m256i next = _mm256_add_epi32(index, one);
+      for (int c = 0; c < 3; ++c) {
+        __m256 a = _mm256_i32gather_ps(channels[c], index, 4);
+        __m256 b = _mm256_i32gather_ps(channels[c], next, 4);
+        __m256 delta = _mm256_mul_ps(_mm256_sub_ps(b, a), t);
+        _mm256_store_ps(out[c], _mm256_add_ps(a, delta));
+      }
+      for (int j = 0; j < 8; ++j) {
+        res[i + j] = Color(out[0][j], out[1][j], out[2][j]);
+      }
+    }
+    return i;
+  }
+#endif
+
   std::vector<Key> keys;
+  // lut_size red values, then green and blue ones, when compiled.
+  std::vector<float> lut;
+  int lut_size = 0;
+  float lut_min = 0;
+  // LUT entries per unit.
+  float lut_scale = 0;
 };
 
 #endif
@@ -0,0 +1,67 @@
+// Compares exact, compiled and batched palette lookups.
+// Usage: palette_benchmark [--n=1048576] [--repeat=10]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "color.h"
+#include "palette.h"
+#include "rand_utils.h"
+
+ABSL_FLAG(int, n, 1 << 20, "Number of values per run");
+ABSL_FLAG(int, repeat, 10, "Number of runs");
+
+// Returns the time per value in nanoseconds.
+template <class F>
+double benchmark(int n, const F& f) {
+  int repeat = absl::GetFlag(FLAGS_repeat);
+  f();  // Warm up.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (double(n) * repeat);
+}
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const int n = absl::GetFlag(FLAGS_n);
+  std::vector<float> vals(n);
+  for (float& val : vals) {
+    val = rand_range(0, 1);
+  }
+  std::vector<Color> res(n);
+  float sum = 0;
+  for (const auto& [name, palette] :
+       {std::make_pair("RedHot (4 keys)", Palette::RedHot()),
+        std::make_pair("Veridis (256 keys)", Palette::Veridis())}) {
+    Palette compiled = palette.compiled();
+    double exact_ns = benchmark(n, [&]() {
+      for (int i = 0; i < n; ++i) {
+        res[i] = palette.color(vals[i]);
+      }
+      sum += res[n / 2].r;
+    });
+    double compiled_ns = benchmark(n, [&]() {
+      for (int i = 0; i < n; ++i) {
+        res[i] = compiled.color(vals[i]);
+      }
+      sum += res[n / 2].r;
+    });
+    double batch_ns = benchmark(n, [&]() {
+      compiled.colors(vals.data(), n, res.data());
+      sum += res[n / 2].r;
+    });
+    std::cout << name << ", ns/value: exact " << exact_ns << ", compiled "
+              << compiled_ns << ", compiled batch " << batch_ns << std::endl;
+  }
+  // Keeps the results alive.
+  std::cout << "checksum: " << sum << std::endl;
+  return 0;
+}
@@ -1,47 +1,20 @@
 #include "perlin_noise.h"
 #include <cmath>
-#include <random>
 #include <algorithm>
-#include <numeric>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PERLIN_NOISE_X86
+#endif
 
 // Initialize with the reference values for the permutation vector
 PerlinNoise::PerlinNoise() {
-
-	// Initialize the permutation vector with the reference values
-	p = {
-		151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,
-		8,99,37,240,21,10,23,190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,
-		35,11,32,57,177,33,88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,
-		134,139,48,27,166,77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,
-		55,46,245,40,244,102,143,54, 65,25,63,161,1,216,80,73,209,76,132,187,208, 89,
-		18,169,200,196,135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,
-		250,124,123,5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,
-		189,28,42,223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167,
-		43,172,9,129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,
-		97,228,251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,
-		107,49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
-		138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180 };
-	// Duplicate the permutation vector
-	auto half_size = p.size();
-    p.resize(half_size * 2);
-    std::copy_n(p.begin(), half_size, p.begin() + half_size);
+	referencePermutation(p);
 }
 
 // Generate a new permutation vector based on the value of seed
 PerlinNoise::PerlinNoise(unsigned int seed) {
-	p.resize(256);
-
-	// Fill p with values from 0 to 255
-	std::iota(p.begin(), p.end(), 0);
-
-	// Initialize a random engine with seed
-	std::default_random_engine engine(seed);
-
-	// Suffle  using the above random engine
-	std::shuffle(p.begin(), p.end(), engine);
-
-	// Duplicate the permutation vector
-	p.insert(p.end(), p.begin(), p.end());
+	randomPermutation(seed, p);
 }
 
 float PerlinNoise::noise(float x, float y, float z) const {
@@ -73,6 +46,39 @@ float PerlinNoise::noise(float x, float y, float z) const {
 	return (res + 1.0)/2.0;
 }
 
+float PerlinNoise::periodicNoise(float x, float y, float z, int period) const {
+	// Find the unit cube that contains the point, wrapped to the period
+	float fx = floor(x);
+	float fy = floor(y);
+	float fz = floor(z);
+	int X0 = (int) fx % period;
+	int Y0 = (int) fy % period;
+	int Z0 = (int) fz % period;
+	if (X0 < 0) X0 += period;
+	if (Y0 < 0) Y0 += period;
+	if (Z0 < 0) Z0 += period;
+	int X1 = (X0 + 1) % period;
+	int Y1 = (Y0 + 1) % period;
+	int Z1 = (Z0 + 1) % period;
+
+	// Find relative x, y,z of point in cube
+	x -= fx;
+	y -= fy;
+	z -= fz;
+
+	float u = fade(x);
+	float v = fade(y);
+	float w = fade(z);
+
+	// Hash coordinates of the 8 cube corners, as in noise()
+	int A0 = p[X0], B0 = p[X1];
+	int AA = p[A0 + Y0], AB = p[A0 + Y1];
+	int BA = p[B0 + Y0], BB = p[B0 + Y1];
+
+	float res = lerp(w, lerp(v, lerp(u, grad(p[AA + Z0], x, y, z), grad(p[BA + Z0], x-1, y, z)), lerp(u, grad(p[AB + Z0], x, y-1, z), grad(p[BB + Z0], x-1, y-1, z))),	lerp(v, lerp(u, grad(p[AA + Z1], x, y, z-1), grad(p[BA + Z1], x-1, y, z-1)), lerp(u, grad(p[AB + Z1], x, y-1, z-1),	grad(p[BB + Z1], x-1, y-1, z-1))));
+	return (res + 1.0)/2.0;
+}
+
 float PerlinNoise::fade(float t) const {
 	return t * t * t * (t * (t * 6 - 15) + 10);
 }
@@ -88,3 +94,142 @@ float PerlinNoise::grad(int hash, float x, float y, float z) const {
 		   v = h < 4 ? y : h == 12 || h == 14 ? x : z;
 	return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
 }
+
+void PerlinNoise::noise(const float* x, const float* y, const float* z,
+                        float* res, size_t n) const {
+#ifdef PERLIN_NOISE_X86
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	if (has_avx2) {
+		noiseAVX2(x, y, z, res, n);
+		return;
+	}
+#endif
+	noiseScalar(x, y, z, res, n);
+}
+
+void PerlinNoise::noiseScalar(const float* x, const float* y, const float* z,
+                              float* res, size_t n) const {
+	for (size_t i = 0; i < n; ++i) {
+		res[i] = noise(x[i], y[i], z[i]);
+	}
+}
+
+#ifdef PERLIN_NOISE_X86
+
+namespace {
+
+// Looks up 8 permutation values. Reads 4 bytes at every index, which the 3
+// bytes of padding after the table make safe.
+__attribute__((target("avx2")))
+inline __m256i perm8(const uint8_t* p, __m256i index) {
+	__m256i bytes = _mm256_i32gather_epi32((const int*)p, index, 1);
+	return _mm256_and_si256(bytes, _mm256_set1_epi32(0xff));
+}
+
+__attribute__((target("avx2")))
+inline __m256 fade8(__m256 t) {
+	// t * t * t * (t * (t * 6 - 15) + 10)
+	__m256 res = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6)),
+	                           _mm256_set1_ps(15));
+	res = _mm256_add_ps(_mm256_mul_ps(t, res), _mm256_set1_ps(10));
+	return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), res);
+}
+
+__attribute__((target("avx2")))
+inline __m256 lerp8(__m256 t, __m256 a, __m256 b) {
+	return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+__attribute__((target("avx2")))
+inline __m256 select8(__m256i mask, __m256 if_true, __m256 if_false) {
+	return _mm256_blendv_ps(if_false, if_true, _mm256_castsi256_ps(mask));
+}
+
+// Same as PerlinNoise::grad.
+__attribute__((target("avx2")))
+inline __m256 grad8(__m256i hash, __m256 x, __m256 y, __m256 z) {
+	__m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+	__m256i lt8 = _mm256_cmpgt_epi32(_mm256_set1_epi32(8), h);
+	__m256i lt4 = _mm256_cmpgt_epi32(_mm256_set1_epi32(4), h);
+	__m256i is12or14 = _mm256_or_si256(
+		_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+		_mm256_cmpeq_epi32(h, _mm256_set1_epi32(14)));
+	__m256 u = select8(lt8, x, y);
+	__m256 v = select8(lt4, y, select8(is12or14, x, z));
+	// Flip the sign bits of u and v according to bits 0 and 1 of h.
+	__m256i u_sign = _mm256_slli_epi32(h, 31);
+	__m256i v_sign = _mm256_slli_epi32(_mm256_srli_epi32(h, 1), 31);
+	u = _mm256_xor_ps(u, _mm256_castsi256_ps(u_sign));
+	v = _mm256_xor_ps(v, _mm256_castsi256_ps(v_sign));
+	return _mm256_add_ps(u, v);
+}
+
+}  // namespace
+
+__attribute__((target("avx2")))
+void PerlinNoise::noiseAVX2(const float* xs, const float* ys, const float* zs,
+                            float* res, size_t n) const {
+	const __m256i mask = _mm256_set1_epi32(255);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256 onef = _mm256_set1_ps(1);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_loadu_ps(xs + i);
+		__m256 y = _mm256_loadu_ps(ys + i);
+		__m256 z = _mm256_loadu_ps(zs + i);
+
+		// Find the unit cube that contains the point
+		__m256 fx = _mm256_floor_ps(x);
+		__m256 fy = _mm256_floor_ps(y);
+		__m256 fz = _mm256_floor_ps(z);
+		__m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+		__m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+		__m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(fz), mask);
+
+		// Find relative x, y,z of point in cube
+		x = _mm256_sub_ps(x, fx);
+		y = _mm256_sub_ps(y, fy);
+		z = _mm256_sub_ps(z, fz);
+
+		__m256 u = fade8(x);
+		__m256 v = fade8(y);
+		__m256 w = fade8(z);
+
+		// Hash coordinates of the 8 cube corners
+		__m256i A = _mm256_add_epi32(perm8(p, X), Y);
+		__m256i AA = _mm256_add_epi32(perm8(p, A), Z);
+		__m256i AB = _mm256_add_epi32(perm8(p, _mm256_add_epi32(A, one)), Z);
+		__m256i B = _mm256_add_epi32(perm8(p, _mm256_add_epi32(X, one)), Y);
+		__m256i BA = _mm256_add_epi32(perm8(p, B), Z);
+		__m256i BB = _mm256_add_epi32(perm8(p, _mm256_add_epi32(B, one)), Z);
+
+		__m256 x1 = _mm256_sub_ps(x, onef);
+		__m256 y1 = _mm256_sub_ps(y, onef);
+		__m256 z1 = _mm256_sub_ps(z, onef);
+
+		// Add blended results from 8 corners of cube
+		__m256 r = lerp8(w,
+			lerp8(v,
+				lerp8(u, grad8(perm8(p, AA), x, y, z),
+				         grad8(perm8(p, BA), x1, y, z)),
+				lerp8(u, grad8(perm8(p, AB), x, y1, z),
+				         grad8(perm8(p, BB), x1, y1, z))),
+			lerp8(v,
+				lerp8(u, grad8(perm8(p, _mm256_add_epi32(AA, one)), x, y, z1),
+				         grad8(perm8(p, _mm256_add_epi32(BA, one)), x1, y, z1)),
+				lerp8(u, grad8(perm8(p, _mm256_add_epi32(AB, one)), x, y1, z1),
+				         grad8(perm8(p, _mm256_add_epi32(BB, one)), x1, y1, z1))));
+		r = _mm256_mul_ps(_mm256_add_ps(r, onef), _mm256_set1_ps(0.5));
+		_mm256_storeu_ps(res + i, r);
+	}
+	noiseScalar(xs + i, ys + i, zs + i, res + i, n - i);
+}
+
+#else
+
+void PerlinNoise::noiseAVX2(const float* x, const float* y, const float* z,
+                            float* res, size_t n) const {
+	noiseScalar(x, y, z, res, n);
+}
+
+#endif
@@ -0,0 +1,374 @@
+/***
+ * Compact pixel formats, to store images in less memory than Color.
+ * Usage:
+ * #include "pixels.h"
+ * Half3 half = Half3(color);  // 6 bytes, 11 significant bits per channel.
+ * RGB9E5 shared = RGB9E5(color);  // 4 bytes, see below.
+ * Color back = Color(half);
+ * pixels::pack(colors, n, halves);  // Batch versions.
+ * pixels::unpack(halves, n, colors);
+ *
+ * Half3 holds IEEE half floats, which keep signs, infinities and values up
+ * to 65504. RGB9E5 holds three 9 bit mantissas sharing a 5 bit exponent (as
+ * GL_RGB9_E5): channels are clamped to [0, 65408] and are off by at most
+ * 2^-9 of the largest one once rounded (or 2^-25 for tiny values), which is
+ * fine for HDR images but not for signed data. 8 bit pixels are RGB (see
+ * rgb.h), clamped to [0, 1].
+ *
+ * The batch versions convert 8 values at a time with F16C or AVX2 when the
+ * CPU supports them, and give the same results as the per pixel ones.
+ ***/
+
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PIXELS_X86
+#endif
+
+#include "color.h"
+#include "rgb.h"
+
+namespace pixels {
+
+inline uint32_t floatBits(float f) {
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+// Rounds to the nearest half, ties to even, as F16C does. NaNs stay NaNs.
+inline uint16_t floatToHalf(float f) {
+  const uint32_t bits = floatBits(f);
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t abs = bits & 0x7fffffff;
+  uint32_t res;
+  if (abs >= 0x47800000) {
+    // At least 65536, infinite or NaN.
+    res = abs > 0x7f800000 ? 0x7e00 : 0x7c00;
+  } else if (abs < 0x38800000) {
+    // Below 2^-14, a denormal half. Adding 0.5 aligns the mantissa on its
+    // last 10 bits and rounds it.
+    res = floatBits(bitsFloat(abs) + 0.5f) - floatBits(0.5f);
+  } else {
+    // Rebias the exponent and round on the 13 dropped bits, which may carry
+    // into the exponent, up to infinity.
+    const uint32_t odd = (abs >> 13) & 1;
+    abs += (uint32_t(15 - 127) << 23) + 0xfff + odd;
+    res = abs >> 13;
+  }
+  return res | sign;
+}
+
+inline float halfToFloat(uint16_t half) {
+  const uint32_t exponent_mask = 0x7c00 << 13;
+  uint32_t bits = uint32_t(half & 0x7fff) << 13;
+  const uint32_t exponent = bits & exponent_mask;
+  bits += uint32_t(127 - 15) << 23;
+  if (exponent == exponent_mask) {
+    // Infinite or NaN.
+    bits += uint32_t(128 - 16) << 23;
+  } else if (exponent == 0) {
+    // Zero or denormal: scale the mantissa as a normal float.
+    bits += 1 << 23;
+    bits = floatBits(bitsFloat(bits) - bitsFloat(113 << 23));
+  }
+  return bitsFloat(bits | uint32_t(half & 0x8000) << 16);
+}
+
+// RGB9E5 constants: values are m * 2^(e - kExponentBias - kMantissaBits).
+constexpr int kMantissaBits = 9;
+constexpr int kExponentBias = 15;
+constexpr float kSharedExponentMax = 65408;
+
+// The shared exponent e, for a largest channel of `max` in
+// [0, kSharedExponentMax], before rounding: floor(log2(max)) + 1 + bias,
+// at least 0. Denormal and zero channels have a float exponent of -127.
+inline int sharedExponent(float max) {
+  const int exponent = int(floatBits(max) >> 23) - 127;
+  return std::max(exponent, -kExponentBias - 1) + 1 + kExponentBias;
+}
+
+// 2^(kExponentBias + kMantissaBits - e), which scales channels to mantissas.
+inline float mantissaScale(int e) {
+  return bitsFloat(uint32_t(127 + kExponentBias + kMantissaBits - e) << 23);
+}
+
+inline float clampChannel(float v) {
+  // Also maps NaNs to 0, as max returns its first argument for them.
+  return std::min(std::max(0.f, v), kSharedExponentMax);
+}
+
+inline uint32_t encodeRGB9E5(float r, float g, float b) {
+  r = clampChannel(r);
+  g = clampChannel(g);
+  b = clampChannel(b);
+  const float max = std::max(std::max(r, g), b);
+  int e = sharedExponent(max);
+  // Rounding the largest channel may overflow its mantissa.
+  if (uint32_t(max * mantissaScale(e) + 0.5f) == 1 << kMantissaBits) {
+    e++;
+  }
+  const float scale = mantissaScale(e);
+  return uint32_t(r * scale + 0.5f) | uint32_t(g * scale + 0.5f) << 9 |
+         uint32_t(b * scale + 0.5f) << 18 | uint32_t(e) << 27;
+}
+
+inline Color decodeRGB9E5(uint32_t bits) {
+  const float scale = 1 / mantissaScale(bits >> 27);
+  return Color((bits & 511) * scale, (bits >> 9 & 511) * scale,
+               (bits >> 18 & 511) * scale);
+}
+
+}  // namespace pixels
+
+struct Half3 {
+  uint16_t r = 0, g = 0, b = 0;
+
+  Half3() {}
+
+  explicit Half3(const Color& color)
+      : r(pixels::floatToHalf(color.r)),
+        g(pixels::floatToHalf(color.g)),
+        b(pixels::floatToHalf(color.b)) {}
+
+  operator Color() const {
+    return Color(pixels::halfToFloat(r), pixels::halfToFloat(g),
+                 pixels::halfToFloat(b));
+  }
+
+  bool operator==(const Half3& other) const {
+    return r == other.r && g == other.g && b == other.b;
+  }
+};
+
+struct RGB9E5 {
+  uint32_t bits = 0;
+
+  RGB9E5() {}
+
+  explicit RGB9E5(const Color& color)
+      : bits(pixels::encodeRGB9E5(color.r, color.g, color.b)) {}
+
+  operator Color() const { return pixels::decodeRGB9E5(bits); }
+
+  bool operator==(const RGB9E5& other) const { return bits == other.bits; }
+};
+
+static_assert(sizeof(Color) == 3 * sizeof(float));
+static_assert(sizeof(Half3) == 3 * sizeof(uint16_t));
+static_assert(sizeof(RGB) == 3);
+
+namespace pixels {
+
+#ifdef PIXELS_X86
+// The SIMD versions of the conversions below. They return the number of
+// pixels converted.
+
+// Colors and Half3 are 3 floats and 3 halves, converted as flat arrays.
+__attribute__((target("avx,f16c")))
+inline size_t packF16C(const Color* colors, size_t n, Half3* res) {
+  const float* in = &colors[0].r;
+  uint16_t* out = &res[0].r;
+  size_t i = 0;
+  for (; i + 8 <= 3 * n; i += 8) {
+    __m128i halves =
+        _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), halves);
+  }
+  return i / 3;
+}
+
+__attribute__((target("avx,f16c")))
+inline size_t unpackF16C(const Half3* halves, size_t n, Color* res) {
+  const uint16_t* in = &halves[0].r;
+  float* out = &res[0].r;
+  size_t i = 0;
+  for (; i + 8 <= 3 * n; i += 8) {
+    __m256 floats = _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+    _mm256_storeu_ps(out + i, floats);
+  }
+  return i / 3;
+}
+
+// Same operations as encodeRGB9E5, on 8 pixels.
+__attribute__((target("avx2")))
+inline size_t packAVX2(const Color* colors, size_t n, RGB9E5* res) {
+  const float* in = &colors[0].r;
+  const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 max_value = _mm256_set1_ps(kSharedExponentMax);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256i min_exponent = _mm256_set1_epi32(-kExponentBias - 1);
+  const __m256i scale_exponent =
+      _mm256_set1_epi32(127 + kExponentBias + kMantissaBits);
+  const __m256i overflow = _mm256_set1_epi32(1 << kMantissaBits);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 channels[3];
+    for (int c = 0; c < 3; ++c) {
+      __m256 v = _mm256_i32gather_ps(in + 3 * i + c, stride, 4);
+      // max_ps returns its second operand for NaNs.
+      channels[c] = _mm256_min_ps(_mm256_max_ps(v, zero), max_value);
+    }
+    __m256 max = _mm256_max_ps(_mm256_max_ps(channels[0], channels[1]),
+                               channels[2]);
+    __m256i e = _mm256_srli_epi32(_mm256_castps_si256(max), 23);
+    e = _mm256_sub_epi32(e, _mm256_set1_epi32(127));
+    e = _mm256_add_epi32(_mm256_max_epi32(e, min_exponent),
+                         _mm256_set1_epi32(1 + kExponentBias));
+    __m256 scale = _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_sub_epi32(scale_exponent, e), 23));
+    __m256i max_mantissa =
+        _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(max, scale), half));
+    // Adds 1 where the mantissa overflows, as comparisons return -1.
+    e = _mm256_sub_epi32(e, _mm256_cmpeq_epi32(max_mantissa, overflow));
+    scale = _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_sub_epi32(scale_exponent, e), 23));
+    __m256i bits = _mm256_slli_epi32(e, 27);
+    for (int c = 0; c < 3; ++c) {
+      __m256i mantissa = _mm256_cvttps_epi32(
+          _mm256_add_ps(_mm256_mul_ps(channels[c], scale), half));
+      bits = _mm256_or_si256(bits, _mm256_slli_epi32(mantissa, 9 * c));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&res[i].bits), bits);
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t unpackAVX2(const RGB9E5* pixels, size_t n, Color* res) {
+  const __m256i mask = _mm256_set1_epi32(511);
+  const __m256i bias = _mm256_set1_epi32(127 - kExponentBias - kMantissaBits);
+  alignas(32) float out[3][8];
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i bits =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&pixels[i].bits));
+    // 1 / mantissaScale(e) = 2^(e - kExponentBias - kMantissaBits).
+    __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(
+        _mm256_add_epi32(_mm256_srli_epi32(bits, 27), bias), 23));
+    for (int c = 0; c < 3; ++c) {
+      __m256i mantissa =
+          _mm256_and_si256(_mm256_srli_epi32(bits, 9 * c), mask);
+      _mm256_store_ps(out[c],
+                      _mm256_mul_ps(_mm256_cvtepi32_ps(mantissa), scale));
+    }
+    for (int j = 0; j < 8; ++j) {
+      res[i + j] = Color(out[0][j], out[1][j], out[2][j]);
+    }
+  }
+  return i;
+}
+
+// Same as RGB(color): scaled by 255, clamped and truncated.
+__attribute__((target("avx2")))
+inline size_t packAVX2(const Color* colors, size_t n, RGB* res) {
+  const float* in = &colors[0].r;
+  byte* out = &res[0].r;
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 max = _mm256_set1_ps(255);
+  alignas(32) int32_t values[8];
+  size_t i = 0;
+  for (; i + 8 <= 3 * n; i += 8) {
+    __m256 v = _mm256_mul_ps(_mm256_loadu_ps(in + i), max);
+    v = _mm256_min_ps(_mm256_max_ps(v, zero), max);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(values),
+                       _mm256_cvttps_epi32(v));
+    for (int j = 0; j < 8; ++j) {
+      out[i + j] = values[j];
+    }
+  }
+  return i / 3;
+}
+#endif
+
+// res[i] = Half3(colors[i]) for i in [0, n).
+inline void pack(const Color* colors, size_t n, Half3* res) {
+  size_t i = 0;
+#ifdef PIXELS_X86
+  static const bool has_f16c = __builtin_cpu_supports("f16c");
+  if (has_f16c) {
+    i = packF16C(colors, n, res);
+  }
+#endif
+  for (; i < n; ++i) {
+    res[i] = Half3(colors[i]);
+  }
+}
+
+inline void unpack(const Half3* halves, size_t n, Color* res) {
+  size_t i = 0;
+#ifdef PIXELS_X86
+  static const bool has_f16c = __builtin_cpu_supports("f16c");
+  if (has_f16c) {
+    i = unpackF16C(halves, n, res);
+  }
+#endif
+  for (; i < n; ++i) {
+    res[i] = halves[i];
+  }
+}
+
+inline void pack(const Color* colors, size_t n, RGB9E5* res) {
+  size_t i = 0;
+#ifdef PIXELS_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) {
+    i = packAVX2(colors, n, res);
+  }
+#endif
+  for (; i < n; ++i) {
+    res[i] = RGB9E5(colors[i]);
+  }
+}
+
+inline void unpack(const RGB9E5* pixels, size_t n, Color* res) {
+  size_t i = 0;
+#ifdef PIXELS_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) {
+    i = unpackAVX2(pixels, n, res);
+  }
+#endif
+  for (; i < n; ++i) {
+    res[i] = pixels[i];
+  }
+}
+
+inline void pack(const Color* colors, size_t n, RGB* res) {
+  size_t i = 0;
+#ifdef PIXELS_X86
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) {
+    i = packAVX2(colors, n, res);
+  }
+#endif
+  for (; i < n; ++i) {
+    res[i] = RGB(colors[i]);
+  }
+}
+
+inline void unpack(const RGB* pixels, size_t n, Color* res) {
+  for (size_t i = 0; i < n; ++i) {
+    res[i] = pixels[i];
+  }
+}
+
+}  // namespace pixels
+
+#endif
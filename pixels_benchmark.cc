@@ -0,0 +1,72 @@
+// Compares the batch pixel conversions of pixels.h with per pixel loops.
+// Usage: pixels_benchmark [--n=4194304] [--repeat=10]
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "color.h"
+#include "pixels.h"
+#include "rand_utils.h"
+#include "rgb.h"
+
+ABSL_FLAG(int, n, 1 << 22, "Number of pixels per run");
+ABSL_FLAG(int, repeat, 10, "Number of runs");
+
+// Returns the time per pixel in nanoseconds.
+template <class F>
+double benchmark(int n, const F& f) {
+  int repeat = absl::GetFlag(FLAGS_repeat);
+  f();  // Warm up.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    f();
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (double(n) * repeat);
+}
+
+// Times packing and unpacking n colors as Pixels.
+template <class Pixel>
+void compare(const char* name, const std::vector<Color>& colors,
+             float* sum) {
+  const int n = colors.size();
+  std::vector<Pixel> packed(n);
+  std::vector<Color> unpacked(n);
+  double pack_ns = benchmark(n, [&]() {
+    for (int i = 0; i < n; ++i) {
+      packed[i] = Pixel(colors[i]);
+    }
+  });
+  double batch_pack_ns =
+      benchmark(n, [&]() { pixels::pack(colors.data(), n, packed.data()); });
+  double unpack_ns = benchmark(n, [&]() {
+    for (int i = 0; i < n; ++i) {
+      unpacked[i] = packed[i];
+    }
+  });
+  double batch_unpack_ns = benchmark(
+      n, [&]() { pixels::unpack(packed.data(), n, unpacked.data()); });
+  *sum += unpacked[n / 2].r;
+  std::cout << name << ", ns per pixel: pack " << pack_ns << ", batch "
+            << batch_pack_ns << "; unpack " << unpack_ns << ", batch "
+            << batch_unpack_ns << std::endl;
+}
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  std::vector<Color> colors(absl::GetFlag(FLAGS_n));
+  for (Color& color : colors) {
+    color = Color(rand_range(0, 2), rand_range(0, 1), rand_range(0, 100));
+  }
+  float sum = 0;
+  compare<Half3>("Half3", colors, &sum);
+  compare<RGB9E5>("RGB9E5", colors, &sum);
+  compare<RGB>("RGB", colors, &sum);
+  // Keeps the results alive.
+  std::cout << "checksum: " << sum << std::endl;
+  return 0;
+}
@@ -9,6 +9,12 @@
 struct Ray {
     vec3 origin;
     vec3 direction;
+    // Radius of the ray's pixel cone per unit of distance, 0 for an infinitely
+    // thin ray.
+    float spread = 0;
+    // Distance marched so far, including by the rays this one was reflected
+    // from.
+    float traveled = 0;
 
     Ray(const vec3& origin, const vec3& direction):
     origin(origin), direction(direction) {
@@ -17,6 +23,12 @@ struct Ray {
 
     void march(float distance) {
       origin += direction * distance;
+      traveled += distance;
+    }
+
+    // Radius of the pixel cone at the origin.
+    float footprint() const {
+      return spread * traveled;
     }
 
     void marchWithGravity(float distance, const std::vector<PointMass*>& masses) {
@@ -33,6 +45,7 @@ struct Ray {
       direction += total_force * distance;
       direction.inormalize();
       origin += direction * distance;
+      traveled += distance;
     }
 
     std::string str() const {
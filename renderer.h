@@ -3,6 +3,7 @@
 
 #include "color.h"
 #include "counters.h"
+#include "footprint.h"
 #include "mat4.h"
 #include "scene.h"
 #include "vec3.h"
@@ -25,6 +26,8 @@ class Renderer {
   struct IlluminationParams {
     vec3 intersection_point;
     vec3 ray_direction;
+    float ray_spread;
+    float ray_traveled;
     vec3 normal;
     Material material;
     Color color_at_intersection;
@@ -50,7 +53,8 @@ class Renderer {
     int num_steps;
     bool hit = march(ray, &r, &num_steps);
     if (scene_->rendering_params().render_march_iterations) {
-      return Palette::Veridis().color(double(num_steps) / 100);
+      static const Palette heatmap = Palette::Veridis().compiled();
+      return heatmap.color(double(num_steps) / 100);
     }
     if (hit) {
       IlluminationParams p;
@@ -59,6 +63,8 @@ class Renderer {
       p.color_at_intersection = p.material.color(p.intersection_point);
       p.normal = scene_->root()->normal(p.intersection_point);
       p.ray_direction = ray.direction;
+      p.ray_spread = ray.spread;
+      p.ray_traveled = ray.traveled;
       // vec3 eye = view_world_matrix_ * scene_->rendering_params().camera_settings.eye_pos;
       vec3 eye = scene_->rendering_params().camera_settings.eye_pos;
       p.to_eye = (eye - p.intersection_point).normalize();
@@ -75,6 +81,8 @@ class Renderer {
          *num_steps < scene_->rendering_params().max_marching_steps;
          ++(*num_steps)) {
       COUNTER_INC(num_marching_steps);
+      // Left set after a hit, so that shading uses the hit's footprint.
+      footprint::set(ray.footprint());
       *res = scene_->root()->sdf(ray.origin);
       if (res->dist < scene_->rendering_params().epsilon) {
         return true;
@@ -134,6 +142,8 @@ class Renderer {
     if (remaining_depth == 0) return colors::BLACK;
     Ray reflected_ray(p.intersection_point,
                       p.ray_direction.reflect(p.normal));
+    reflected_ray.spread = p.ray_spread;
+    reflected_ray.traveled = p.ray_traveled;
     int num_iters = 1;
     if (p.material.roughness > 0) {
       num_iters = scene_->rendering_params().roughness_iterations;
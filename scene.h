@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <iostream>
+#include "arena.h"
 #include "sdf.h"
 #include "light.h"
 #include "point_mass.h"
@@ -11,7 +12,22 @@
 class Scene {
 public:
   Scene() {
-    root_sdf = new MultiUnion();
+    root_sdf = make<MultiUnion>();
+  }
+
+  // Allocates a scene object (SDF, colorizer, light, mass...) in the scene's
+  // arena. All such objects are freed together with the scene.
+  template <class T, class... Args>
+  T* make(Args&&... args) {
+    return arena_.make<T>(std::forward<Args>(args)...);
+  }
+
+  const Arena& arena() const {
+    return arena_;
+  }
+
+  Arena* modifiable_arena() {
+    return &arena_;
   }
 
   const RenderingParams& rendering_params() const {
@@ -24,15 +40,6 @@ public:
 
   ~Scene() {
     std::cerr << "Deleting scene" << std::endl;
-    for (int i = 0; i < objects_.size(); ++i) {
-      delete objects_[i];
-    }
-    for (int i = 0; i < lights_.size(); ++i) {
-      delete lights_[i];
-    }
-    for (int i = 0; i < masses_.size(); ++i) {
-      delete masses_[i];
-    }
   }
 
   const std::string name() const {
@@ -47,6 +54,10 @@ public:
     return root_sdf;
   }
 
+  MultiUnion* modifiable_root() {
+    return root_sdf;
+  }
+
   SDF* addObject(SDF *sdf) {
     root_sdf->addChild(sdf);
 
@@ -84,6 +95,8 @@ public:
   }
 
 private:
+  // Declared first so that it outlives everything pointing into it.
+  Arena arena_;
   RenderingParams rendering_params_;
   MultiUnion* root_sdf = 0;
   std::vector<SDF*> objects_;
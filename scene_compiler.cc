@@ -0,0 +1,33 @@
+#include <stdlib.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "logging.h"
+#include "scenes/scene_file.h"
+
+ABSL_FLAG(std::string, input, "", "the text scene file to compile");
+ABSL_FLAG(std::string, output, "", "where to write the compiled scene file");
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  CHECK(!absl::GetFlag(FLAGS_input).empty()) << "--input is required";
+  CHECK(!absl::GetFlag(FLAGS_output).empty()) << "--output is required";
+
+  std::ifstream in(absl::GetFlag(FLAGS_input), std::ifstream::binary);
+  CHECK(in.good()) << "cannot open '" << absl::GetFlag(FLAGS_input) << "'";
+  std::ofstream out(absl::GetFlag(FLAGS_output), std::ofstream::binary);
+  CHECK(out.good()) << "cannot open '" << absl::GetFlag(FLAGS_output) << "'";
+  scene_file::CompileSceneFile(in, out);
+  out.close();
+
+  std::ifstream compiled(absl::GetFlag(FLAGS_output), std::ifstream::binary);
+  for (const std::string& name : scene_file::ListScenes(compiled)) {
+    std::cout << "Compiled scene " << name << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,916 @@
+#include "scene_file.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <utility>
+
+#include "../colorizer.h"
+#include "../distance_cache.h"
+#include "../light.h"
+#include "../logging.h"
+#include "../point_mass.h"
+#include "../sdf.h"
+
+namespace scene_file {
+
+namespace {
+
+const char kMagic[8] = {'R', 'R', 'S', 'C', 'E', 'N', 'E', '\0'};
+const uint32_t kVersion = 1;
+
+// Text format.
+
+struct Token {
+  enum Kind { WORD, NUMBER, OPEN, CLOSE, SEMICOLON, END };
+
+  Kind kind = END;
+  std::string text;
+  int line = 0;
+};
+
+// Splits a text scene file into tokens, reading one character at a time so
+// that arbitrarily large files never need to be held in memory.
+class Tokenizer {
+ public:
+  Tokenizer(std::istream& in) : in_(in) {}
+
+  const Token& peek() {
+    if (!has_peeked_) {
+      peeked_ = read();
+      has_peeked_ = true;
+    }
+    return peeked_;
+  }
+
+  Token next() {
+    peek();
+    has_peeked_ = false;
+    return peeked_;
+  }
+
+ private:
+  static bool isWordChar(int c) {
+    return isalnum(c) || c == '_' || c == '.' || c == '-' || c == '+';
+  }
+
+  Token read() {
+    skipWhitespaceAndComments();
+    Token token;
+    token.line = line_;
+    int c = in_.get();
+    if (c == EOF) {
+      token.kind = Token::END;
+    } else if (c == '{') {
+      token.kind = Token::OPEN;
+    } else if (c == '}') {
+      token.kind = Token::CLOSE;
+    } else if (c == ';') {
+      token.kind = Token::SEMICOLON;
+    } else if (c == '"') {
+      token.kind = Token::WORD;
+      for (c = in_.get(); c != '"'; c = in_.get()) {
+        CHECK(c != EOF && c != '\n')
+            << "line " << token.line << ": unterminated string";
+        token.text += char(c);
+      }
+    } else {
+      CHECK(isWordChar(c)) << "line " << token.line
+                           << ": unexpected character '" << char(c) << "'";
+      token.text += char(c);
+      while (isWordChar(in_.peek())) {
+        token.text += char(in_.get());
+      }
+      token.kind = isNumber(token.text) ? Token::NUMBER : Token::WORD;
+    }
+    return token;
+  }
+
+  static bool isNumber(const std::string& s) {
+    if (s.size() > 1 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+      return false;
+    }
+    char* end;
+    strtof(s.c_str(), &end);
+    return end != s.c_str() && *end == '\0';
+  }
+
+  void skipWhitespaceAndComments() {
+    while (true) {
+      int c = in_.peek();
+      if (c == '\n') {
+        line_++;
+        in_.get();
+      } else if (isspace(c)) {
+        in_.get();
+      } else if (c == '#') {
+        while (in_.peek() != '\n' && in_.peek() != EOF) {
+          in_.get();
+        }
+      } else {
+        return;
+      }
+    }
+  }
+
+  std::istream& in_;
+  Token peeked_;
+  bool has_peeked_ = false;
+  int line_ = 1;
+};
+
+class Parser {
+ public:
+  Parser(std::istream& in) : tokenizer_(in) {}
+
+  // Reads the header of the next scene (`scene NAME {`). Returns false at the
+  // end of the file.
+  bool nextScene(std::string* name, int* line) {
+    Token token = tokenizer_.next();
+    if (token.kind == Token::END) {
+      return false;
+    }
+    CHECK(token.kind == Token::WORD && token.text == "scene")
+        << "line " << token.line << ": expected 'scene', got '" << token.text
+        << "'";
+    Token name_token = tokenizer_.next();
+    CHECK(name_token.kind == Token::WORD || name_token.kind == Token::NUMBER)
+        << "line " << name_token.line << ": expected a scene name";
+    CHECK(tokenizer_.next().kind == Token::OPEN)
+        << "line " << name_token.line << ": expected '{' after scene name";
+    *name = name_token.text;
+    *line = token.line;
+    return true;
+  }
+
+  // Skips a body whose '{' was already consumed, without building any nodes.
+  void skipBody() {
+    int depth = 1;
+    while (depth > 0) {
+      Token token = tokenizer_.next();
+      CHECK(token.kind != Token::END) << "unexpected end of file";
+      if (token.kind == Token::OPEN) {
+        depth++;
+      } else if (token.kind == Token::CLOSE) {
+        depth--;
+      }
+    }
+  }
+
+  // Parses a body whose '{' was already consumed into the children of `node`.
+  void parseBody(Node* node) {
+    node->has_body = true;
+    while (tokenizer_.peek().kind != Token::CLOSE) {
+      node->children.emplace_back();
+      parseStatement(&node->children.back());
+    }
+    tokenizer_.next();
+  }
+
+ private:
+  void parseStatement(Node* node) {
+    Token type = tokenizer_.next();
+    CHECK(type.kind == Token::WORD)
+        << "line " << type.line << ": expected a statement, got '" << type.text
+        << "'";
+    node->type = type.text;
+    node->line = type.line;
+    while (true) {
+      Token token = tokenizer_.next();
+      switch (token.kind) {
+        case Token::WORD:
+          node->args.push_back(Value(token.text));
+          break;
+        case Token::NUMBER:
+          node->args.push_back(Value(strtof(token.text.c_str(), 0)));
+          break;
+        case Token::SEMICOLON:
+          return;
+        case Token::OPEN:
+          parseBody(node);
+          return;
+        default:
+          CHECK(false) << "line " << token.line << ": unterminated statement '"
+                       << node->type << "'";
+      }
+    }
+  }
+
+  Tokenizer tokenizer_;
+};
+
+// Compiled format.
+//
+// magic[8] version:u32 num_scenes:u32, then for every scene:
+//   name_len:u32 name body_size:u64 body
+// where body is:
+//   num_strings:u32 (len:u32 bytes)* node
+// and node is:
+//   type:u32 line:u32 has_body:u8 num_args:u32 (kind:u8 (f32 | u32))*
+//   num_children:u32 node*
+// Strings are stored once per scene and referenced by index.
+
+class BinaryWriter {
+ public:
+  void u8(uint8_t v) { out_.append((const char*)&v, sizeof(v)); }
+  void u32(uint32_t v) { out_.append((const char*)&v, sizeof(v)); }
+  void u64(uint64_t v) { out_.append((const char*)&v, sizeof(v)); }
+  void f32(float v) { out_.append((const char*)&v, sizeof(v)); }
+  void str(const std::string& s) {
+    u32(s.size());
+    out_.append(s);
+  }
+  void bytes(const std::string& s) { out_.append(s); }
+
+  const std::string& data() const { return out_; }
+
+ private:
+  std::string out_;
+};
+
+class BinaryReader {
+ public:
+  BinaryReader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+  uint8_t u8() { return read<uint8_t>(); }
+  uint32_t u32() { return read<uint32_t>(); }
+  float f32() { return read<float>(); }
+  std::string str() {
+    uint32_t len = u32();
+    CHECK(p_ + len <= end_) << "truncated compiled scene";
+    std::string res(p_, len);
+    p_ += len;
+    return res;
+  }
+
+ private:
+  template <class T>
+  T read() {
+    CHECK(p_ + sizeof(T) <= end_) << "truncated compiled scene";
+    T res;
+    memcpy(&res, p_, sizeof(T));
+    p_ += sizeof(T);
+    return res;
+  }
+
+  const char* p_;
+  const char* end_;
+};
+
+class SceneEncoder {
+ public:
+  std::string encode(const Node& scene) {
+    collectStrings(scene);
+    BinaryWriter body;
+    body.u32(strings_.size());
+    for (const std::string& s : strings_) {
+      body.str(s);
+    }
+    encodeNode(scene, &body);
+    return body.data();
+  }
+
+ private:
+  uint32_t stringId(const std::string& s) {
+    auto it = string_ids_.find(s);
+    if (it != string_ids_.end()) {
+      return it->second;
+    }
+    string_ids_[s] = strings_.size();
+    strings_.push_back(s);
+    return strings_.size() - 1;
+  }
+
+  void collectStrings(const Node& node) {
+    stringId(node.type);
+    for (const Value& arg : node.args) {
+      if (arg.kind == Value::WORD) {
+        stringId(arg.word);
+      }
+    }
+    for (const Node& child : node.children) {
+      collectStrings(child);
+    }
+  }
+
+  void encodeNode(const Node& node, BinaryWriter* out) {
+    out->u32(stringId(node.type));
+    out->u32(node.line);
+    out->u8(node.has_body);
+    out->u32(node.args.size());
+    for (const Value& arg : node.args) {
+      out->u8(arg.kind);
+      if (arg.kind == Value::NUMBER) {
+        out->f32(arg.number);
+      } else {
+        out->u32(stringId(arg.word));
+      }
+    }
+    out->u32(node.children.size());
+    for (const Node& child : node.children) {
+      encodeNode(child, out);
+    }
+  }
+
+  std::map<std::string, uint32_t> string_ids_;
+  std::vector<std::string> strings_;
+};
+
+class SceneDecoder {
+ public:
+  SceneDecoder(const std::string& body) : reader_(body.data(), body.size()) {}
+
+  void decode(Node* scene) {
+    uint32_t num_strings = reader_.u32();
+    strings_.reserve(num_strings);
+    for (uint32_t i = 0; i < num_strings; ++i) {
+      strings_.push_back(reader_.str());
+    }
+    decodeNode(scene);
+  }
+
+ private:
+  const std::string& string(uint32_t id) {
+    CHECK(id < strings_.size()) << "invalid string id " << id;
+    return strings_[id];
+  }
+
+  void decodeNode(Node* node) {
+    node->type = string(reader_.u32());
+    node->line = reader_.u32();
+    node->has_body = reader_.u8();
+    uint32_t num_args = reader_.u32();
+    node->args.resize(num_args);
+    for (Value& arg : node->args) {
+      arg.kind = Value::Kind(reader_.u8());
+      if (arg.kind == Value::NUMBER) {
+        arg.number = reader_.f32();
+      } else {
+        arg.word = string(reader_.u32());
+      }
+    }
+    node->children.resize(reader_.u32());
+    for (Node& child : node->children) {
+      decodeNode(&child);
+    }
+  }
+
+  BinaryReader reader_;
+  std::vector<std::string> strings_;
+};
+
+template <class T>
+T ReadPod(std::istream& in) {
+  T res;
+  in.read((char*)&res, sizeof(T));
+  CHECK(in.good()) << "truncated compiled scene file";
+  return res;
+}
+
+// Calls `visit` with the name of every scene in a compiled file. If `visit`
+// returns true, the body of that scene is read into `body` and the iteration
+// stops; otherwise the body is skipped.
+bool ScanCompiled(std::istream& in,
+                  const std::function<bool(const std::string&)>& visit,
+                  std::string* body) {
+  char magic[sizeof(kMagic)];
+  in.read(magic, sizeof(magic));
+  CHECK(in.good() && memcmp(magic, kMagic, sizeof(kMagic)) == 0)
+      << "not a compiled scene file";
+  uint32_t version = ReadPod<uint32_t>(in);
+  CHECK(version == kVersion)
+      << "unsupported compiled scene version " << version;
+  uint32_t num_scenes = ReadPod<uint32_t>(in);
+  for (uint32_t i = 0; i < num_scenes; ++i) {
+    std::string name(ReadPod<uint32_t>(in), '\0');
+    in.read(&name[0], name.size());
+    uint64_t body_size = ReadPod<uint64_t>(in);
+    if (visit(name)) {
+      body->resize(body_size);
+      in.read(&(*body)[0], body_size);
+      CHECK(in.good()) << "truncated compiled scene file";
+      return true;
+    }
+    in.seekg(body_size, std::ios::cur);
+  }
+  return false;
+}
+
+// Scene building.
+
+std::string Where(const Node& node) {
+  return "line " + std::to_string(node.line) + " (" + node.type + "): ";
+}
+
+const Node* FindProperty(const Node& node, const std::string& key) {
+  for (const Node& child : node.children) {
+    if (!child.has_body && child.type == key) {
+      return &child;
+    }
+  }
+  return 0;
+}
+
+// The values of properties.
+float FloatValue(const Node& prop) {
+  CHECK(prop.args.size() == 1 && prop.args[0].kind == Value::NUMBER)
+      << Where(prop) << "expected a single number";
+  return prop.args[0].number;
+}
+
+bool BoolValue(const Node& prop) {
+  CHECK(prop.args.size() == 1) << Where(prop) << "expected a single value";
+  const Value& v = prop.args[0];
+  if (v.kind == Value::NUMBER) {
+    return v.number != 0;
+  }
+  CHECK(v.word == "true" || v.word == "false")
+      << Where(prop) << "expected true or false";
+  return v.word == "true";
+}
+
+vec3 Vec3Value(const Node& prop) {
+  CHECK(prop.args.size() == 3) << Where(prop) << "expected 3 numbers";
+  for (const Value& v : prop.args) {
+    CHECK(v.kind == Value::NUMBER) << Where(prop) << "expected 3 numbers";
+  }
+  return vec3(prop.args[0].number, prop.args[1].number, prop.args[2].number);
+}
+
+float GetFloat(const Node& node, const std::string& key, float default_value) {
+  const Node* prop = FindProperty(node, key);
+  return prop == 0 ? default_value : FloatValue(*prop);
+}
+
+vec3 GetVec3(const Node& node, const std::string& key,
+             const vec3& default_value) {
+  const Node* prop = FindProperty(node, key);
+  return prop == 0 ? default_value : Vec3Value(*prop);
+}
+
+std::string GetWord(const Node& node, const std::string& key) {
+  const Node* prop = FindProperty(node, key);
+  if (prop == 0) {
+    return "";
+  }
+  CHECK(prop->args.size() == 1 && prop->args[0].kind == Value::WORD)
+      << Where(*prop) << "expected a single name";
+  return prop->args[0].word;
+}
+
+// Colors are either hex words (0xRRGGBB) or triplets of numbers.
+std::vector<Color> ParseColors(const Node& prop) {
+  std::vector<Color> res;
+  const std::vector<Value>& args = prop.args;
+  for (size_t i = 0; i < args.size();) {
+    if (args[i].kind == Value::WORD) {
+      char* end;
+      long packed = strtol(args[i].word.c_str(), &end, 16);
+      CHECK(*end == '\0') << Where(prop) << "invalid color '" << args[i].word
+                          << "'";
+      res.push_back(Color(int(packed)));
+      i++;
+    } else {
+      CHECK(i + 2 < args.size() && args[i + 1].kind == Value::NUMBER &&
+            args[i + 2].kind == Value::NUMBER)
+          << Where(prop) << "expected r g b";
+      res.push_back(Color(args[i].number, args[i + 1].number,
+                          args[i + 2].number));
+      i += 3;
+    }
+  }
+  return res;
+}
+
+Color GetColor(const Node& node, const std::string& key,
+               const Color& default_value) {
+  const Node* prop = FindProperty(node, key);
+  if (prop == 0) {
+    return default_value;
+  }
+  std::vector<Color> colors = ParseColors(*prop);
+  CHECK(colors.size() == 1) << Where(*prop) << "expected a single color";
+  return colors[0];
+}
+
+// `noise perlin;` or `noise simplex;`, perlin by default.
+Noise::Type GetNoise(const Node& node) {
+  std::string name = GetWord(node, "noise");
+  if (name.empty() || name == "perlin") {
+    return Noise::PERLIN;
+  }
+  CHECK(name == "simplex") << Where(node) << "unknown noise '" << name << "'";
+  return Noise::SIMPLEX;
+}
+
+std::string ArgWord(const Node& node, size_t i, const std::string& what) {
+  CHECK(i < node.args.size() && node.args[i].kind == Value::WORD)
+      << Where(node) << "expected " << what;
+  return node.args[i].word;
+}
+
+class SceneBuilder {
+ public:
+  Scene* build(const Node& scene_node) {
+    scene_ = new Scene();
+    scene_->setName(ArgWord(scene_node, 0, "a scene name"));
+    for (const Node& node : scene_node.children) {
+      CHECK(node.has_body) << Where(node) << "unexpected property in scene";
+      if (node.type == "params") {
+        buildParams(node);
+      } else if (node.type == "material") {
+        materials_[ArgWord(node, 0, "a material name")] = buildMaterial(node);
+      } else if (node.type == "colorizer") {
+        colorizers_[ArgWord(node, 0, "a colorizer name")] =
+            buildColorizer(node);
+      } else if (node.type == "light") {
+        scene_->addLight(buildLight(node));
+      } else if (node.type == "mass") {
+        scene_->addMass(make<PointMass>(GetVec3(node, "position", vec3()),
+                                        GetFloat(node, "mass", 0)));
+      } else {
+        scene_->addObject(buildSDF(node));
+      }
+    }
+    return scene_;
+  }
+
+ private:
+  // All objects are owned by the scene's arena.
+  template <class T, class... Args>
+  T* make(Args&&... args) {
+    return scene_->make<T>(std::forward<Args>(args)...);
+  }
+
+  struct MaterialDef {
+    Material material;
+    Colorizer* colorizer = 0;
+  };
+
+  // Each param is set from its own line, so repeated params use the last
+  // value.
+  void buildParams(const Node& node) {
+    RenderingParams& p = scene_->modifiable_rendering_params();
+    static const std::map<std::string,
+                          std::function<void(const Node&, RenderingParams*)>>
+        setters = {
+#define NUMBER_PARAM(name, field)                     \
+  {#name, [](const Node& param, RenderingParams* p) { \
+     p->field = FloatValue(param);                    \
+   }}
+#define BOOL_PARAM(name, field)                       \
+  {#name, [](const Node& param, RenderingParams* p) { \
+     p->field = BoolValue(param);                     \
+   }}
+#define VEC3_PARAM(name, field)                       \
+  {#name, [](const Node& param, RenderingParams* p) { \
+     p->field = Vec3Value(param);                     \
+   }}
+            NUMBER_PARAM(width, width),
+            NUMBER_PARAM(height, height),
+            NUMBER_PARAM(max_marching_steps, max_marching_steps),
+            NUMBER_PARAM(max_dist, max_dist),
+            NUMBER_PARAM(epsilon, epsilon),
+            BOOL_PARAM(do_shading, do_shading),
+            NUMBER_PARAM(aa_factor, aa_factor),
+            NUMBER_PARAM(reflection_depth, reflection_depth),
+            NUMBER_PARAM(roughness_iterations, roughness_iterations),
+            BOOL_PARAM(use_gravity, use_gravity),
+            BOOL_PARAM(light_decay, light_decay),
+            NUMBER_PARAM(screen_z, screen_z),
+            BOOL_PARAM(render_march_iterations, render_march_iterations),
+            NUMBER_PARAM(frames, animation_params.frames),
+            NUMBER_PARAM(time_delta, animation_params.time_delta),
+            VEC3_PARAM(eye_pos, camera_settings.eye_pos),
+            VEC3_PARAM(target, camera_settings.target),
+            VEC3_PARAM(up, camera_settings.up),
+#undef NUMBER_PARAM
+#undef BOOL_PARAM
+#undef VEC3_PARAM
+        };
+    for (const Node& param : node.children) {
+      auto it = setters.find(param.type);
+      CHECK(it != setters.end() && !param.has_body)
+          << Where(param) << "unknown rendering param";
+      it->second(param, &p);
+    }
+  }
+
+  MaterialDef buildMaterial(const Node& node) {
+    MaterialDef def;
+    std::string colorizer_name = GetWord(node, "colorizer");
+    if (!colorizer_name.empty()) {
+      auto it = colorizers_.find(colorizer_name);
+      CHECK(it != colorizers_.end())
+          << Where(node) << "unknown colorizer '" << colorizer_name << "'";
+      def.colorizer = it->second;
+      def.material = Material(def.colorizer);
+    } else {
+      def.material = Material(GetColor(node, "color", colors::PURPLE));
+    }
+    Material& m = def.material;
+    m.ambient = GetFloat(node, "ambient", m.ambient);
+    m.diffuse = GetFloat(node, "diffuse", m.diffuse);
+    m.reflect = GetFloat(node, "reflect", m.reflect);
+    m.roughness = GetFloat(node, "roughness", m.roughness);
+    m.specular = GetFloat(node, "specular", m.specular);
+    m.shininess = GetFloat(node, "shininess", m.shininess);
+    return def;
+  }
+
+  Colorizer* buildColorizer(const Node& node) {
+    std::string kind = ArgWord(node, 1, "a colorizer type");
+    if (kind == "checkerboard") {
+      return make<CheckerboardColorizer>(
+          GetColor(node, "color1", colors::WHITE),
+          GetColor(node, "color2", colors::BLACK), GetFloat(node, "scale", 1));
+    } else if (kind == "perlin") {
+      const Node* colors_prop = FindProperty(node, "colors");
+      CHECK(colors_prop != 0) << Where(node) << "missing colors";
+      std::vector<Color> palette_colors = ParseColors(*colors_prop);
+      CHECK(palette_colors.size() >= 2)
+          << Where(*colors_prop) << "expected at least 2 colors";
+      PerlinNoiseColorizer* colorizer = make<PerlinNoiseColorizer>(
+          Palette(palette_colors), GetFloat(node, "scale", 1),
+          GetFloat(node, "octaves", 1), GetNoise(node));
+      if (FindProperty(node, "texture_resolution") != 0) {
+        NoiseTexture::Params params;
+        params.resolution =
+            GetFloat(node, "texture_resolution", params.resolution);
+        params.period = GetFloat(node, "texture_period", params.period);
+        colorizer->bake(params);
+      }
+      return colorizer;
+    }
+    CHECK(false) << Where(node) << "unknown colorizer type '" << kind << "'";
+    return 0;
+  }
+
+  Light* buildLight(const Node& node) {
+    std::string kind = ArgWord(node, 0, "a light type");
+    if (kind == "point") {
+      return make<PointLight>(GetVec3(node, "position", vec3()));
+    } else if (kind == "directional") {
+      return make<DirectionalLight>(GetVec3(node, "direction", vec3(0, -1, 0)));
+    } else if (kind == "spot") {
+      return make<SpotLight>(GetVec3(node, "position", vec3()),
+                             GetVec3(node, "direction", vec3(0, 0, 1)),
+                             GetFloat(node, "angle", M_PI / 10));
+    }
+    CHECK(false) << Where(node) << "unknown light type '" << kind << "'";
+    return 0;
+  }
+
+  // Returns the material of a primitive, either a reference to a named
+  // material (`material name;`) or an inline one (`material { ... }`).
+  const MaterialDef* materialOf(const Node& node) {
+    for (const Node& child : node.children) {
+      if (child.type != "material") {
+        continue;
+      }
+      if (child.has_body) {
+        inline_materials_.push_back(buildMaterial(child));
+        return &inline_materials_.back();
+      }
+      std::string name = ArgWord(child, 0, "a material name");
+      auto it = materials_.find(name);
+      CHECK(it != materials_.end())
+          << Where(child) << "unknown material '" << name << "'";
+      return &it->second;
+    }
+    return &default_material_;
+  }
+
+  // Binds the colorizer of a primitive's material to the primitive's surface.
+  void bindSurface(const MaterialDef* def, ParametrizableSurface* surface) {
+    if (CheckerboardColorizer* c =
+            dynamic_cast<CheckerboardColorizer*>(def->colorizer)) {
+      c->setSurface(surface);
+    } else if (PerlinNoiseColorizer* c =
+                   dynamic_cast<PerlinNoiseColorizer*>(def->colorizer)) {
+      c->setSurface(surface);
+    }
+  }
+
+  std::vector<SDF*> sdfChildren(const Node& node) {
+    std::vector<SDF*> res;
+    for (const Node& child : node.children) {
+      if (child.has_body && child.type != "material" && child.type != "by") {
+        res.push_back(buildSDF(child));
+      }
+    }
+    return res;
+  }
+
+  SDF* singleChild(const Node& node) {
+    std::vector<SDF*> children = sdfChildren(node);
+    CHECK(children.size() == 1) << Where(node) << "expected a single child";
+    return children[0];
+  }
+
+  SDF* buildSDF(const Node& node) {
+    CHECK(node.has_body) << Where(node) << "expected an object";
+    const std::string& type = node.type;
+    if (type == "sphere") {
+      const MaterialDef* def = materialOf(node);
+      Sphere* sphere = make<Sphere>(GetVec3(node, "center", vec3()),
+                                    GetFloat(node, "radius", 1), def->material);
+      bindSurface(def, sphere);
+      return sphere;
+    } else if (type == "plane") {
+      const MaterialDef* def = materialOf(node);
+      vec3 normal = GetVec3(node, "normal", vec3(0, 1, 0)).normalize();
+      vec3 axis1 = GetVec3(node, "axis1", normal.randomOrthonormalVec());
+      vec3 axis2 = GetVec3(node, "axis2", normal.cross(axis1));
+      Plane* plane = make<Plane>(normal, axis1, axis2, def->material);
+      bindSurface(def, plane);
+      return plane;
+    } else if (type == "translate") {
+      return make<Translate>(singleChild(node),
+                             GetVec3(node, "offset", vec3()));
+    } else if (type == "scale") {
+      return make<Scale>(singleChild(node), GetFloat(node, "factor", 1));
+    } else if (type == "expand") {
+      return make<Expand>(singleChild(node), GetFloat(node, "radius", 0));
+    } else if (type == "negate") {
+      return make<Negate>(singleChild(node));
+    } else if (type == "periodic") {
+      return make<Periodic>(singleChild(node), GetVec3(node, "period", vec3()));
+    } else if (type == "pointwise_multiply") {
+      return make<PointwiseMultiply>(singleChild(node),
+                                     GetVec3(node, "factor", vec3(1, 1, 1)));
+    } else if (type == "union") {
+      std::vector<SDF*> children = sdfChildren(node);
+      CHECK(children.size() >= 2) << Where(node) << "expected 2+ children";
+      if (children.size() == 2) {
+        return make<Union>(children[0], children[1]);
+      }
+      MultiUnion* res = make<MultiUnion>();
+      for (SDF* child : children) {
+        res->addChild(child);
+      }
+      return res;
+    } else if (type == "intersection") {
+      std::vector<SDF*> children = sdfChildren(node);
+      CHECK(children.size() >= 2) << Where(node) << "expected 2+ children";
+      SDF* res = children[0];
+      for (size_t i = 1; i < children.size(); ++i) {
+        res = make<Intersection>(res, children[i]);
+      }
+      return res;
+    } else if (type == "smooth") {
+      std::vector<SDF*> children = sdfChildren(node);
+      CHECK(children.size() == 2) << Where(node) << "expected 2 children";
+      return make<Smooth>(children[0], children[1], GetFloat(node, "k", 1));
+    } else if (type == "bound") {
+      const Node* by = 0;
+      for (const Node& child : node.children) {
+        if (child.type == "by" && child.has_body) {
+          by = &child;
+        }
+      }
+      CHECK(by != 0) << Where(node) << "missing 'by { ... }' bounding object";
+      return make<Bound>(singleChild(node), singleChild(*by),
+                         GetFloat(node, "distance", 1));
+    } else if (type == "distance_cache") {
+      DistanceCache::Params params;
+      params.voxel_size = GetFloat(node, "voxel_size", params.voxel_size);
+      params.brick_size = GetFloat(node, "brick_size", params.brick_size);
+      params.narrow_band = GetFloat(node, "narrow_band", params.narrow_band);
+      params.exact_distance =
+          GetFloat(node, "exact_distance", params.exact_distance);
+      params.lipschitz = GetFloat(node, "lipschitz", params.lipschitz);
+      params.max_bytes = GetFloat(node, "max_bytes", params.max_bytes);
+      return make<DistanceCache>(singleChild(node), params);
+    } else if (type == "perlin_deformation") {
+      ParametrizableSurfaceSDF* child =
+          dynamic_cast<ParametrizableSurfaceSDF*>(singleChild(node));
+      CHECK(child != 0) << Where(node) << "child must be a sphere or a plane";
+      return make<PerlinDeformation>(child, GetFloat(node, "scale", 1),
+                                     GetFloat(node, "magnitude", 1),
+                                     GetFloat(node, "octaves", 1),
+                                     GetNoise(node));
+    }
+    CHECK(false) << Where(node) << "unknown object type";
+    return 0;
+  }
+
+  Scene* scene_ = 0;
+  std::map<std::string, MaterialDef> materials_;
+  std::map<std::string, Colorizer*> colorizers_;
+  std::deque<MaterialDef> inline_materials_;
+  MaterialDef default_material_;
+};
+
+}  // namespace
+
+bool IsCompiled(std::istream& in) {
+  char magic[sizeof(kMagic)];
+  in.read(magic, sizeof(magic));
+  bool res = in.gcount() == sizeof(magic) &&
+             memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  in.clear();
+  in.seekg(-in.gcount(), std::ios::cur);
+  return res;
+}
+
+std::vector<std::string> ListScenes(std::istream& in) {
+  std::vector<std::string> res;
+  if (IsCompiled(in)) {
+    std::string body;
+    ScanCompiled(
+        in,
+        [&res](const std::string& name) {
+          res.push_back(name);
+          return false;
+        },
+        &body);
+    return res;
+  }
+  Parser parser(in);
+  std::string name;
+  int line;
+  while (parser.nextScene(&name, &line)) {
+    res.push_back(name);
+    parser.skipBody();
+  }
+  return res;
+}
+
+bool FindScene(std::istream& in, const std::string& name, Node* scene) {
+  if (IsCompiled(in)) {
+    std::string body;
+    if (!ScanCompiled(
+            in, [&name](const std::string& n) { return n == name; }, &body)) {
+      return false;
+    }
+    SceneDecoder(body).decode(scene);
+    return true;
+  }
+  Parser parser(in);
+  std::string scene_name;
+  int line;
+  while (parser.nextScene(&scene_name, &line)) {
+    if (scene_name != name) {
+      parser.skipBody();
+      continue;
+    }
+    scene->type = "scene";
+    scene->args = {Value(scene_name)};
+    scene->line = line;
+    parser.parseBody(scene);
+    return true;
+  }
+  return false;
+}
+
+Scene* BuildScene(const Node& scene) { return SceneBuilder().build(scene); }
+
+Scene* LoadScene(std::istream& in, const std::string& name) {
+  Node node;
+  if (!FindScene(in, name, &node)) {
+    return 0;
+  }
+  return BuildScene(node);
+}
+
+Scene* LoadSceneFile(const std::string& filename, const std::string& name) {
+  std::ifstream file(filename, std::ifstream::binary);
+  CHECK(file.good()) << "cannot open scene file '" << filename << "'";
+  return LoadScene(file, name);
+}
+
+void CompileSceneFile(std::istream& in, std::ostream& out) {
+  std::vector<std::pair<std::string, std::string>> compiled;
+  Parser parser(in);
+  std::string name;
+  int line;
+  while (parser.nextScene(&name, &line)) {
+    Node scene;
+    scene.type = "scene";
+    scene.args = {Value(name)};
+    scene.line = line;
+    parser.parseBody(&scene);
+    compiled.emplace_back(name, SceneEncoder().encode(scene));
+  }
+
+  BinaryWriter header;
+  header.bytes(std::string(kMagic, sizeof(kMagic)));
+  header.u32(kVersion);
+  header.u32(compiled.size());
+  out.write(header.data().data(), header.data().size());
+  for (const auto& [scene_name, body] : compiled) {
+    BinaryWriter scene_header;
+    scene_header.str(scene_name);
+    scene_header.u64(body.size());
+    out.write(scene_header.data().data(), scene_header.data().size());
+    out.write(body.data(), body.size());
+  }
+}
+
+}  // namespace scene_file
@@ -0,0 +1,85 @@
+/***
+ * Declarative scene files.
+ *
+ * A scene file holds one or more scenes. Every statement is either a property
+ * (`key values... ;`) or a node with a body (`type args... { statements }`):
+ *
+ * # Two red spheres on a floor.
+ * scene TwoSpheres {
+ *   params { reflection_depth 2; eye_pos 0 2 -10; target 0 0 20; }
+ *   material red { color 1 0 0; ambient 0; diffuse 0.5; reflect 0.5; }
+ *   colorizer checkers checkerboard { color1 1 1 1; color2 0 0 0; scale 0.3; }
+ *   material floor { colorizer checkers; reflect 0.9; }
+ *   union {
+ *     sphere { center -2 0 20; radius 1.5; material red; }
+ *     sphere { center 2 0 20; radius 1.5; material red; }
+ *   }
+ *   translate { offset 0 -2 0; plane { normal 0 1 0; material floor; } }
+ *   light point { position -10 10 20; }
+ *   mass { position 0 0 20; mass 0.001; }
+ * }
+ *
+ * Scene files are parsed as a stream and only the requested scene is built;
+ * the bodies of all other scenes are skipped without being parsed into nodes.
+ * CompileSceneFile converts a text file into a binary form which stores every
+ * scene as a length-prefixed block, so loading a compiled scene is a seek and a
+ * single read followed by decoding of pre-tokenized nodes.
+ ***/
+
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../scene.h"
+
+namespace scene_file {
+
+struct Value {
+  enum Kind { NUMBER, WORD };
+
+  Value() {}
+  Value(float number) : kind(NUMBER), number(number) {}
+  Value(const std::string& word) : kind(WORD), word(word) {}
+
+  Kind kind = NUMBER;
+  float number = 0;
+  std::string word;
+};
+
+struct Node {
+  std::string type;
+  std::vector<Value> args;
+  std::vector<Node> children;
+  bool has_body = false;
+  int line = 0;
+};
+
+// Returns true if the stream starts with the compiled scene file magic. Does
+// not consume any input.
+bool IsCompiled(std::istream& in);
+
+// Returns the names of all scenes in a text or compiled scene file.
+std::vector<std::string> ListScenes(std::istream& in);
+
+// Finds the scene called `name` and returns its node, without building it.
+// Returns false if there is no such scene.
+bool FindScene(std::istream& in, const std::string& name, Node* scene);
+
+// Builds a scene from a parsed scene node.
+Scene* BuildScene(const Node& scene);
+
+// Loads and builds the scene called `name` from a text or compiled scene file.
+// The caller owns the returned scene. Returns 0 if there is no such scene.
+Scene* LoadScene(std::istream& in, const std::string& name);
+Scene* LoadSceneFile(const std::string& filename, const std::string& name);
+
+// Converts all scenes in a text scene file into the compiled binary form.
+void CompileSceneFile(std::istream& in, std::ostream& out);
+
+}  // namespace scene_file
+
+#endif
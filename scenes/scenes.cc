@@ -1,33 +1,73 @@
 #include "scenes.h"
 
+#include <chrono>
+#include <iostream>
 #include <map>
 #include <memory>
-#include <iostream>
+#include <mutex>
 
 #include "../logging.h"
 #include "../singleton.h"
 
 class SceneRegistry {
  public:
+  void RegisterScene(const std::string &name,
+                     const scenes::SceneFactory &factory) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::cout << "Registering scene " << name << std::endl;
+    Entry &entry = registry_[name];
+    entry.factory = factory;
+    entry.scene.reset();
+  }
+
   void RegisterScene(Scene *scene) {
+    std::lock_guard<std::mutex> guard(mutex_);
     std::cout << "Registering scene " << scene->name() << std::endl;
-    registry_[scene->name()].reset(scene);
+    registry_[scene->name()].scene.reset(scene);
   }
 
   Scene *GetScene(const std::string &name) {
+    std::lock_guard<std::mutex> guard(mutex_);
     auto it = registry_.find(name);
-    CHECK(it != registry_.end());
-    return it->second.get();
+    CHECK(it != registry_.end()) << "unknown scene '" << name
+                                 << "', known scenes: " << names();
+    Entry &entry = it->second;
+    if (!entry.scene) {
+      auto start = std::chrono::steady_clock::now();
+      entry.scene.reset(entry.factory());
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::cout << "Constructed scene " << name << " in " << elapsed.count()
+                << "s" << std::endl;
+    }
+    return entry.scene.get();
   }
 
  private:
-  std::map<std::string, std::shared_ptr<Scene>> registry_;
+  struct Entry {
+    scenes::SceneFactory factory;
+    std::shared_ptr<Scene> scene;
+  };
+
+  std::string names() const {
+    std::string res;
+    for (const auto &[name, entry] : registry_) {
+      res += (res.empty() ? "" : ", ") + name;
+    }
+    return res;
+  }
+
+  std::mutex mutex_;
+  std::map<std::string, Entry> registry_;
 };
 
 SINGLETON(SceneRegistry, SceneRegistrySingleton);
 
 namespace scenes {
 
+void RegisterScene(const std::string &name, const SceneFactory &factory) {
+  SceneRegistrySingleton::instance().RegisterScene(name, factory);
+}
 void RegisterScene(Scene *scene) {
   SceneRegistrySingleton::instance().RegisterScene(scene);
 }
@@ -1,5 +1,6 @@
 #include "../scene.h"
 
+#include <functional>
 #include <string>
 
 #define DEFINE_SCENE(name)    \
@@ -7,17 +8,25 @@
    public:                    \
     name();                   \
   };                          \
-  static SceneRegisterer<name> registerer;
+  static SceneRegisterer<name> registerer(#name);
 
 namespace scenes {
 
+typedef std::function<Scene*()> SceneFactory;
+
+// Registers a factory for a scene. Scenes are only constructed the first time
+// they are requested with GetScene.
+void RegisterScene(const std::string& name, const SceneFactory& factory);
+// Registers an already constructed scene.
 void RegisterScene(Scene* scene);
 Scene* GetScene(const std::string& name);
 
 template <class SceneClass>
 class SceneRegisterer {
  public:
-  SceneRegisterer() { RegisterScene(new SceneClass); }
+  SceneRegisterer(const std::string& name) {
+    RegisterScene(name, []() -> Scene* { return new SceneClass; });
+  }
 };
 
 }  // namespace scenes
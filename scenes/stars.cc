@@ -7,7 +7,7 @@ namespace scenes {
 
 DEFINE_SCENE(Stars);
 
-Sphere* createStar() {
+Sphere* createStar(Scene* scene) {
   Color color = colors::WHITE;
   switch (rand() % 50) {
     case 0:
@@ -36,11 +36,11 @@ Sphere* createStar() {
   Material material(color, brightness, 0, 0, 0);
   vec3 center = vec3::random() * 1000;
   float radius = rand_range(0.3, 0.8);
-  return new Sphere(center, radius, material);
+  return scene->make<Sphere>(center, radius, material);
 }
 
-void AddStarKDTree(SpheresKDTree* container) {
-  container->addChild(createStar());
+void AddStarKDTree(SpheresKDTree* container, Scene* scene) {
+  container->addChild(createStar(scene));
 }
 
 void AddBigStar(std::initializer_list<Color> colors, float perlin_scale,
@@ -48,21 +48,19 @@ void AddBigStar(std::initializer_list<Color> colors, float perlin_scale,
                 float deformation_magnitude, float radius, const vec3& center,
                 float mass, Scene* scene) {
   PerlinNoiseColorizer* colorizer =
-      new PerlinNoiseColorizer(colors, perlin_scale);
+      scene->make<PerlinNoiseColorizer>(colors, perlin_scale);
   Material material(colorizer, ambient, diffuse, 0, 0);
-  Sphere* sphere = new Sphere(center, radius, material);
+  Sphere* sphere = scene->make<Sphere>(center, radius, material);
   SDF* star = sphere;
   colorizer->setSurface((Sphere*)star);
   if (deformation_magnitude > 0) {
-    star = new PerlinDeformation((Sphere*)star, deformation_scale,
-                                 deformation_magnitude);
-    SDF* bound_obj =
-        new Sphere(center, radius + deformation_magnitude, Material());
-    star = new Bound(star, bound_obj, 0.1);
+    // Bounded automatically by SDFOptimizer::addBounds.
+    star = scene->make<PerlinDeformation>((Sphere*)star, deformation_scale,
+                                          deformation_magnitude);
   }
   star = scene->addObject(star);
   if (mass > 0) {
-    PointMass* pm = new PointMass(center, mass);
+    PointMass* pm = scene->make<PointMass>(center, mass);
     scene->addMass(pm);
   }
 }
@@ -99,26 +97,26 @@ Stars::Stars() {
   AddBigStar(Color(0, 0, 0), Color(0, 0, 0), 0, 0.0, 0.0, 0, 0, 7,
              vec3(-20, -15, 10), 3, this);
 
-  SDF* inner_sphere = new Sphere(vec3(), 999, Material());
-  SDF* outer_sphere = new Sphere(vec3(), 1001, Material());
-  SDF* bound_obj = new Intersection(new Negate(inner_sphere), outer_sphere);
+  SDF* inner_sphere = make<Sphere>(vec3(), 999, Material());
+  SDF* outer_sphere = make<Sphere>(vec3(), 1001, Material());
+  SDF* bound_obj = make<Intersection>(make<Negate>(inner_sphere), outer_sphere);
 
-  SpheresKDTree* kdtree = new SpheresKDTree();
-  addObject(new Bound(kdtree, bound_obj, 1));
+  SpheresKDTree* kdtree = make<SpheresKDTree>(modifiable_arena());
+  addObject(make<Bound>(kdtree, bound_obj, 1));
 
   const int NUM_BACKGROUND_STARS = 1'000'000;
   // const int NUM_BACKGROUND_STARS = 1000;
   for (int i = 0; i < NUM_BACKGROUND_STARS; ++i) {
-    AddStarKDTree(kdtree);
+    AddStarKDTree(kdtree, this);
   }
 
   kdtree->compile();
 
   for (int i = 0; i < 500; ++i) {
-    addLight(new PointLight(sun_center + vec3::random() * (sun_radius + 2)));
+    addLight(make<PointLight>(sun_center + vec3::random() * (sun_radius + 2)));
   }
 
-  addLight(new PointLight(vec3(100, 100, 2)));
+  addLight(make<PointLight>(vec3(100, 100, 2)));
 
   modifiable_rendering_params().camera_settings.eye_pos = vec3(0, 0, -200);
   modifiable_rendering_params().camera_settings.target = vec3(0, 0, 0);
@@ -126,7 +124,7 @@ Stars::Stars() {
   // modifiable_rendering_params().gravity_slowdown_factor = 500;
   modifiable_rendering_params().max_marching_steps = 50000;
 
-  addLight(new DirectionalLight(vec3(-1, -1, -1)));
+  addLight(make<DirectionalLight>(vec3(-1, -1, -1)));
 
   modifiable_rendering_params().use_gravity = true;
   // modifiable_rendering_params().animation_params.frames = 100;
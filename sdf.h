@@ -3,15 +3,17 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <vector>
 
+#include "aabb.h"
 #include "vec3.h"
 #include "color.h"
 #include "counters.h"
+#include "footprint.h"
 #include "material.h"
 #include "colorizer.h"
-#include "perlin_noise.h"
-#include "object_registry.h"
+#include "noise.h"
 
 struct SDFResult {
   SDFResult() {}
@@ -33,8 +35,15 @@ public:
 
   virtual ~SDF() {}
 
-  SDF() {
-    registry::registry.registerObject(this);
+  // Replaces every child with f(child), for the function f given. Used by
+  // passes over the SDF graph (see sdf_optimizer.h), which must only
+  // substitute equivalent SDFs. Nodes without children ignore f.
+  virtual void mapChildren(const std::function<SDF*(SDF*)>&) {}
+
+  // A box containing every point where sdf(v).dist <= 0. Infinite unless the
+  // node knows better.
+  virtual AABB bounds() const {
+    return AABB();
   }
 
   vec3 normal(const vec3& v) const {
@@ -119,6 +128,10 @@ public:
     return SDFResult(dist, material);
   }
 
+  AABB bounds() const {
+    return AABB::around(center, radius);
+  }
+
   vec3 center;
   float radius;
   Material material;
@@ -126,22 +139,37 @@ public:
 
 class PerlinDeformation : public SDF {
 public:
-  PerlinDeformation(ParametrizableSurfaceSDF* child, float scale, float magnitude)
-    : child(child), scale(scale), magnitude(magnitude) {}
+  PerlinDeformation(ParametrizableSurfaceSDF* child, float scale,
+                    float magnitude, int octaves = 1,
+                    Noise::Type noise_type = Noise::PERLIN)
+    : child(child), scale(scale), magnitude(magnitude), octaves(octaves),
+      noise(Noise::get(noise_type)) {}
 
   SDFResult sdf(const vec3& v) const {
     SDF_COUNTERS(perlin_deformation);
 
-    float alpha = perlin.noise(v.x * scale, v.y * scale, v.z * scale);
+    // Octaves finer than the pixel footprint are left out.
+    float alpha = noise->fbm(v.x * scale, v.y * scale, v.z * scale, octaves,
+                             Noise::detail(footprint::get() * scale, octaves));
     SDFResult res = child->sdf(v);
     res.dist += magnitude * alpha;
     return res;
   }
+  AABB bounds() const {
+    return child->bounds().expand(std::abs(magnitude));
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = dynamic_cast<ParametrizableSurfaceSDF*>(f(child));
+    CHECK(child != 0) << "perlin deformation of a non parametrizable surface";
+  }
+
 private:
   ParametrizableSurfaceSDF* child;
   float scale;
   float magnitude;
-  PerlinNoise perlin;
+  int octaves;
+  const Noise* noise;
 };
 
 class Plane : public ParametrizableSurfaceSDF {
@@ -149,11 +177,13 @@ public:
   Plane(const vec3& normal,
         const vec3& checkerboard_axis1,
         const vec3& checkerboard_axis2,
-        const Material& material) :
+        const Material& material,
+        float offset = 0) :
     normal(normal),
     checkerboard_axis1(checkerboard_axis1),
     checkerboard_axis2(checkerboard_axis2),
-    material(material) {}
+    material(material),
+    offset(offset) {}
 
   void coordinates(const vec3& vec, float* u, float* v) const {
     *u = checkerboard_axis1.dot(vec);
@@ -162,14 +192,17 @@ public:
 
   SDFResult sdf(const vec3& v) const {
     SDF_COUNTERS(plane);
-    SDFResult res(v.dot(normal), material);
+    SDFResult res(v.dot(normal) + offset, material);
     return res;
   }
 
 private:
+  friend class SDFOptimizer;
+
   vec3 normal;
   vec3 checkerboard_axis1, checkerboard_axis2;
   Material material;
+  float offset;
 };
 
 class MultiUnion : public SDF {
@@ -197,7 +230,23 @@ public:
     return res;
   }
 
+  AABB bounds() const {
+    AABB res = AABB::empty();
+    for (const SDF* child : children) {
+      res = res | child->bounds();
+    }
+    return res;
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    for (SDF*& child : children) {
+      child = f(child);
+    }
+  }
+
 private:
+  friend class SDFOptimizer;
+
   // mutable std::vector<SDF *>children;
   std::vector<SDF *>children;
 };
@@ -223,7 +272,18 @@ public:
     return r2;
   }
 
+  AABB bounds() const {
+    return obj1->bounds() | obj2->bounds();
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    obj1 = f(obj1);
+    obj2 = f(obj2);
+  }
+
 private:
+  friend class SDFOptimizer;
+
   // mutable SDF *obj1;
   // mutable SDF *obj2;
   SDF *obj1;
@@ -251,6 +311,15 @@ public:
     return r2;
   }
 
+  AABB bounds() const {
+    return obj1->bounds() & obj2->bounds();
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    obj1 = f(obj1);
+    obj2 = f(obj2);
+  }
+
 private:
   // mutable SDF *obj1;
   // mutable SDF *obj2;
@@ -278,6 +347,16 @@ public:
     return SDFResult(dist, mat);
   }
 
+  // The smooth minimum is at most 1 / k below the minimum.
+  AABB bounds() const {
+    return (obj1->bounds() | obj2->bounds()).expand(1 / k);
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    obj1 = f(obj1);
+    obj2 = f(obj2);
+  }
+
 private:
   SDF *obj1;
   SDF *obj2;
@@ -294,6 +373,10 @@ public:
     return res;
   }
 
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+  }
+
 private:
   SDF *child;
   vec3 period;
@@ -308,7 +391,17 @@ public:
     return child->sdf(v - t);
   }
 
+  AABB bounds() const {
+    return child->bounds().translate(t);
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+  }
+
 private:
+  friend class SDFOptimizer;
+
   SDF *child;
   vec3 t;
 };
@@ -324,7 +417,17 @@ public:
     return res;
   }
 
+  AABB bounds() const {
+    return child->bounds().expand(std::max(r, 0.0f));
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+  }
+
 private:
+  friend class SDFOptimizer;
+
   SDF *child;
   float r;
 };
@@ -340,7 +443,17 @@ public:
     return res;
   }
 
+  AABB bounds() const {
+    return child->bounds().preimage(vec3(1, 1, 1) / r, vec3());
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+  }
+
 private:
+  friend class SDFOptimizer;
+
   SDF *child;
   float r;
 };
@@ -354,11 +467,54 @@ public:
     return child->sdf(vec3(v.x * t.x, v.y * t.y, v.z * t.z));
   }
 
+  AABB bounds() const {
+    return child->bounds().preimage(t, vec3());
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+  }
+
 private:
+  friend class SDFOptimizer;
+
   SDF *child;
   vec3 t;
 };
 
+// Evaluates the child at (v.x * scale.x + offset.x, ...) and multiplies the
+// distance by dist_scale. Produced by fusing chains of Translate, Scale and
+// PointwiseMultiply.
+class Affine : public SDF {
+public:
+  Affine(SDF *child, const vec3& scale, const vec3& offset, float dist_scale)
+    : child(child), scale(scale), offset(offset), dist_scale(dist_scale) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDF_COUNTERS(affine);
+    SDFResult res = child->sdf(vec3(v.x * scale.x + offset.x,
+                                    v.y * scale.y + offset.y,
+                                    v.z * scale.z + offset.z));
+    res.dist *= dist_scale;
+    return res;
+  }
+
+  AABB bounds() const {
+    return child->bounds().preimage(scale, offset);
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+  }
+
+private:
+  friend class SDFOptimizer;
+
+  SDF *child;
+  vec3 scale;
+  vec3 offset;
+  float dist_scale;
+};
 
 class Negate : public SDF {
 public:
@@ -371,7 +527,13 @@ public:
     return res;
   }
 
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+  }
+
 private:
+  friend class SDFOptimizer;
+
   SDF *child;
 };
 
@@ -389,10 +551,49 @@ class Bound : public SDF {
     return child->sdf(v);
   }
 
+  AABB bounds() const {
+    return child->bounds();
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+    bound_sdf = f(bound_sdf);
+  }
+
 private:
   SDF *child;
   SDF *bound_sdf;
   float bound_dist = 1;
 };
 
+// Like Bound, but the bounding object is a box, which is much cheaper to
+// evaluate than most SDFs. Inserted automatically by SDFOptimizer::addBounds.
+class BoxBound : public SDF {
+ public:
+  BoxBound(SDF *child, const AABB& box, float bound_dist)
+    : child(child), box(box), bound_dist(bound_dist) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDF_COUNTERS(box_bound);
+    float dist = box.distance(v);
+    if (dist > bound_dist) {
+      return SDFResult(dist, Material());
+    }
+    return child->sdf(v);
+  }
+
+  AABB bounds() const {
+    return box;
+  }
+
+  void mapChildren(const std::function<SDF*(SDF*)>& f) {
+    child = f(child);
+  }
+
+private:
+  SDF *child;
+  AABB box;
+  float bound_dist;
+};
+
 #endif
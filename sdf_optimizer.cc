@@ -0,0 +1,257 @@
+#include "sdf_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+#include "distance_cache.h"
+#include "kdtree.h"
+
+namespace {
+
+const float kEpsilon = 1e-6;
+
+// Objects cheaper than this are not worth bounding.
+const float kMinBoundedCost = 8;
+
+// Distance from the bounding box at which the bounded object is evaluated.
+const float kBoundDistance = 0.1;
+
+bool isClose(float a, float b) {
+  return std::abs(a - b) <= kEpsilon * std::max(1.0f, std::abs(b));
+}
+
+bool isUniform(const vec3& v) {
+  return isClose(v.x, v.z) && isClose(v.y, v.z);
+}
+
+bool isConstant(const vec3& v, float value) {
+  return v.x == value && v.y == value && v.z == value;
+}
+
+template <class F>
+void forEachNode(SDF* sdf, const F& f) {
+  std::unordered_set<SDF*> seen;
+  std::vector<SDF*> stack = {sdf};
+  while (!stack.empty()) {
+    SDF* node = stack.back();
+    stack.pop_back();
+    if (!seen.insert(node).second) {
+      continue;
+    }
+    f(node);
+    node->mapChildren([&stack](SDF* child) {
+      stack.push_back(child);
+      return child;
+    });
+  }
+}
+
+}  // namespace
+
+void SDFOptimizer::optimize(MultiUnion* root) {
+  nodes_before_ += countNodes(root);
+  optimize((SDF*)root);
+  nodes_after_ += countNodes(root);
+}
+
+SDF* SDFOptimizer::optimize(SDF* sdf) {
+  auto it = optimized_.find(sdf);
+  if (it != optimized_.end()) {
+    return it->second;
+  }
+  sdf->mapChildren([this](SDF* child) { return optimize(child); });
+  SDF* res = simplify(sdf);
+  optimized_[sdf] = res;
+  optimized_[res] = res;
+  return res;
+}
+
+void SDFOptimizer::addBounds(MultiUnion* root) {
+  root->mapChildren([this](SDF* child) { return addBounds(child); });
+}
+
+SDF* SDFOptimizer::addBounds(SDF* sdf) {
+  if (MultiUnion* multi_union = dynamic_cast<MultiUnion*>(sdf)) {
+    addBounds(multi_union);
+    return sdf;
+  }
+  // Distance caches are bounded already.
+  if (dynamic_cast<Bound*>(sdf) != 0 || dynamic_cast<BoxBound*>(sdf) != 0 ||
+      dynamic_cast<DistanceCache*>(sdf) != 0) {
+    return sdf;
+  }
+  AABB box = sdf->bounds();
+  if (!box.isFinite() || cost(sdf) < kMinBoundedCost) {
+    return sdf;
+  }
+  bounds_added_++;
+  return arena_->make<BoxBound>(sdf, box, kBoundDistance);
+}
+
+int SDFOptimizer::countNodes(SDF* sdf) {
+  int res = 0;
+  forEachNode(sdf, [&res](SDF*) { res++; });
+  return res;
+}
+
+float SDFOptimizer::cost(SDF* sdf) {
+  float res = 0;
+  forEachNode(sdf, [&res](SDF* node) {
+    if (dynamic_cast<PerlinDeformation*>(node) != 0 ||
+        dynamic_cast<SpheresKDTree*>(node) != 0) {
+      res += 20;
+    } else if (dynamic_cast<Smooth*>(node) != 0) {
+      res += 4;
+    } else {
+      res += 1;
+    }
+  });
+  return res;
+}
+
+std::string SDFOptimizer::str() const {
+  std::stringstream res;
+  res << "SDF nodes: " << nodes_before_ << " before optimization, "
+      << nodes_after_ << " after (" << fused_transforms_
+      << " transforms fused, " << pushed_transforms_
+      << " pushed into primitives, " << removed_identities_
+      << " identities removed, " << flattened_unions_ << " unions flattened, "
+      << bounds_added_ << " bounds added)" << std::endl;
+  return res.str();
+}
+
+SDF* SDFOptimizer::simplify(SDF* sdf) {
+  AffineParts parts;
+  if (asAffine(sdf, &parts)) {
+    return simplifyAffine(sdf, parts);
+  }
+  if (MultiUnion* multi_union = dynamic_cast<MultiUnion*>(sdf)) {
+    std::vector<SDF*> children;
+    children.swap(multi_union->children);
+    for (SDF* child : children) {
+      flatten(multi_union, child);
+    }
+    return multi_union;
+  }
+  if (Union* union_sdf = dynamic_cast<Union*>(sdf)) {
+    MultiUnion* res = arena_->make<MultiUnion>();
+    flatten(res, union_sdf->obj1);
+    flatten(res, union_sdf->obj2);
+    flattened_unions_++;
+    return res;
+  }
+  if (Negate* negate = dynamic_cast<Negate*>(sdf)) {
+    if (Negate* inner = dynamic_cast<Negate*>(negate->child)) {
+      removed_identities_ += 2;
+      return inner->child;
+    }
+  }
+  if (Expand* expand = dynamic_cast<Expand*>(sdf)) {
+    if (expand->r == 0) {
+      removed_identities_++;
+      return expand->child;
+    }
+  }
+  return sdf;
+}
+
+SDF* SDFOptimizer::simplifyAffine(SDF* sdf, const AffineParts& outer) {
+  AffineParts parts = outer;
+  AffineParts inner;
+  bool fused = false;
+  if (asAffine(parts.child, &inner)) {
+    // outer(v) = inner(v * outer.scale + outer.offset) * outer.dist_scale.
+    parts.child = inner.child;
+    parts.offset = vec3(parts.offset.x * inner.scale.x + inner.offset.x,
+                        parts.offset.y * inner.scale.y + inner.offset.y,
+                        parts.offset.z * inner.scale.z + inner.offset.z);
+    parts.scale = vec3(parts.scale.x * inner.scale.x,
+                       parts.scale.y * inner.scale.y,
+                       parts.scale.z * inner.scale.z);
+    parts.dist_scale *= inner.dist_scale;
+    fused = true;
+    fused_transforms_++;
+  }
+
+  if (isConstant(parts.scale, 1) && isConstant(parts.offset, 0) &&
+      parts.dist_scale == 1) {
+    removed_identities_++;
+    return parts.child;
+  }
+
+  if (isUniform(parts.scale)) {
+    float m = parts.scale.z;
+    float d = parts.dist_scale;
+    // d * (|v * m + o - c| - r) = d|m| * |v - (c - o) / m| - d * r.
+    if (Sphere* sphere = dynamic_cast<Sphere*>(parts.child)) {
+      if (isClose(d * std::abs(m), 1)) {
+        pushed_transforms_++;
+        return arena_->make<Sphere>((sphere->center - parts.offset) / m,
+                                    sphere->radius * d, sphere->material);
+      }
+    }
+    // d * ((v * m + o) . n + offset) = d * m * v . n + d * (o . n + offset).
+    if (Plane* plane = dynamic_cast<Plane*>(parts.child)) {
+      if (isClose(d * m, 1)) {
+        pushed_transforms_++;
+        return arena_->make<Plane>(
+            plane->normal, plane->checkerboard_axis1, plane->checkerboard_axis2,
+            plane->material,
+            d * (parts.offset.dot(plane->normal) + plane->offset));
+      }
+    }
+  }
+
+  if (!fused && dynamic_cast<Affine*>(sdf) == 0) {
+    return sdf;
+  }
+  return arena_->make<Affine>(parts.child, parts.scale, parts.offset,
+                              parts.dist_scale);
+}
+
+void SDFOptimizer::flatten(MultiUnion* dst, SDF* child) {
+  if (MultiUnion* multi_union = dynamic_cast<MultiUnion*>(child)) {
+    // Children were optimized first, so `multi_union` is already flat.
+    for (SDF* grandchild : multi_union->children) {
+      dst->addChild(grandchild);
+    }
+    flattened_unions_++;
+    return;
+  }
+  dst->addChild(child);
+}
+
+bool SDFOptimizer::asAffine(SDF* sdf, AffineParts* parts) {
+  if (Translate* translate = dynamic_cast<Translate*>(sdf)) {
+    parts->child = translate->child;
+    parts->scale = vec3(1, 1, 1);
+    parts->offset = -translate->t;
+    parts->dist_scale = 1;
+    return true;
+  }
+  if (Scale* scale = dynamic_cast<Scale*>(sdf)) {
+    parts->child = scale->child;
+    parts->scale = vec3(1, 1, 1) / scale->r;
+    parts->offset = vec3(0, 0, 0);
+    parts->dist_scale = scale->r;
+    return true;
+  }
+  if (PointwiseMultiply* multiply = dynamic_cast<PointwiseMultiply*>(sdf)) {
+    parts->child = multiply->child;
+    parts->scale = multiply->t;
+    parts->offset = vec3(0, 0, 0);
+    parts->dist_scale = 1;
+    return true;
+  }
+  if (Affine* affine = dynamic_cast<Affine*>(sdf)) {
+    parts->child = affine->child;
+    parts->scale = affine->scale;
+    parts->offset = affine->offset;
+    parts->dist_scale = affine->dist_scale;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,83 @@
+/***
+ * Simplification pass over the SDF graph of a scene.
+ * Usage:
+ * #include "sdf_optimizer.h"
+ * SDFOptimizer optimizer(scene->modifiable_arena());
+ * optimizer.optimize(scene->modifiable_root());
+ * optimizer.addBounds(scene->modifiable_root());
+ * std::cout << optimizer.str() << std::endl;
+ *
+ * The pass works bottom up and only substitutes equivalent SDFs:
+ * - Chains of Translate, Scale and PointwiseMultiply are fused into a single
+ *   Affine node.
+ * - Translations and uniform scalings of a Sphere or a Plane are pushed into
+ *   the primitive (new center and radius, or plane offset).
+ * - Identity transforms, Expand by 0 and double negations are removed.
+ * - Nested Unions and MultiUnions are flattened into one MultiUnion.
+ * New nodes are allocated in the given arena. Replaced nodes are left alone,
+ * as colorizers may still point to the original surfaces.
+ *
+ * addBounds then wraps every expensive object of the scene which has a finite
+ * bounding box (see SDF::bounds) in a BoxBound, so that far from the object
+ * evaluating it costs a single box distance. It also runs without optimize,
+ * as scenes leave bounding their objects to it.
+ ***/
+
+#ifndef SDF_OPTIMIZER_H
+#define SDF_OPTIMIZER_H
+
+#include <string>
+#include <unordered_map>
+
+#include "arena.h"
+#include "sdf.h"
+
+class SDFOptimizer {
+ public:
+  explicit SDFOptimizer(Arena* arena) : arena_(arena) {}
+
+  // Optimizes the graph under `root` in place. The root itself is kept, so
+  // it is safe to call on a scene's root.
+  void optimize(MultiUnion* root);
+
+  // Returns an SDF equivalent to `sdf`.
+  SDF* optimize(SDF* sdf);
+
+  // Wraps expensive objects under `root` in box bounds.
+  void addBounds(MultiUnion* root);
+
+  // Number of distinct nodes reachable from `sdf`.
+  static int countNodes(SDF* sdf);
+
+  // Rough cost of evaluating `sdf`, in units of a sphere evaluation.
+  static float cost(SDF* sdf);
+
+  std::string str() const;
+
+ private:
+  // child(v * scale + offset) * dist_scale.
+  struct AffineParts {
+    SDF* child = 0;
+    vec3 scale = vec3(1, 1, 1);
+    vec3 offset = vec3(0, 0, 0);
+    float dist_scale = 1;
+  };
+
+  SDF* simplify(SDF* sdf);
+  SDF* simplifyAffine(SDF* sdf, const AffineParts& parts);
+  void flatten(MultiUnion* dst, SDF* child);
+  SDF* addBounds(SDF* sdf);
+  static bool asAffine(SDF* sdf, AffineParts* parts);
+
+  Arena* arena_;
+  std::unordered_map<SDF*, SDF*> optimized_;
+  int nodes_before_ = 0;
+  int nodes_after_ = 0;
+  int fused_transforms_ = 0;
+  int pushed_transforms_ = 0;
+  int removed_identities_ = 0;
+  int flattened_unions_ = 0;
+  int bounds_added_ = 0;
+};
+
+#endif
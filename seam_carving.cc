@@ -6,7 +6,6 @@
 #include <fstream>
 #include <iostream>
 #include <string>
-#include <thread>
 #include <vector>
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
@@ -16,6 +15,7 @@
 #include "progress.h"
 #include "rand_utils.h"
 #include "range.h"
+#include "thread_pool.h"
 #include "vec3.h"
 
 ABSL_FLAG(std::string, image, "pagoda", "the name of the input image");
@@ -78,6 +78,10 @@ float seam_energy(const Image& img, int x, int y, int dx) {
 //   return res;
 // }
 
+// Pixels of a row computed per task; smaller blocks cost more to hand out
+// than to compute.
+const int kSeamBlock = 256;
+
 struct Seam {
   int x = 0, y = 0;
   float energy = -1;
@@ -97,27 +101,33 @@ Array2D<Seam> calculate_seams(const Image& image, const farr2d* mask = 0) {
     }
   }
 
+  // Each row only depends on the previous one, so its pixels are independent.
   for (int y = 1; y < image.height(); ++y) {
-    for (int x = 0; x < image.width(); ++x) {
-      Seam* seam = &res(x, y);
-      seam->x = x;
-      seam->y = y;
-      for (int dx = -1; dx <= 1; ++dx) {
-        if (x + dx >= 0 && x + dx < image.width()) {
-          // std::cout << x << " " << y << " " << dx << std::endl;
-          Seam* candidate_parent = &res(x + dx, y - 1);
-          float candidate_energy =
-              candidate_parent->energy + seam_energy(image, x, y, dx);
-          if (mask) {
-            candidate_energy += (*mask)(x, y);
-          }
-          if (seam->energy < 0 || candidate_energy < seam->energy) {
-            res(x, y).energy = candidate_energy;
-            res(x, y).parent = candidate_parent;
+    parallel_for(
+        0, image.width(),
+        [&](int begin, int end) {
+          for (int x = begin; x < end; ++x) {
+            Seam* seam = &res(x, y);
+            seam->x = x;
+            seam->y = y;
+            for (int dx = -1; dx <= 1; ++dx) {
+              if (x + dx >= 0 && x + dx < image.width()) {
+                // std::cout << x << " " << y << " " << dx << std::endl;
+                Seam* candidate_parent = &res(x + dx, y - 1);
+                float candidate_energy =
+                    candidate_parent->energy + seam_energy(image, x, y, dx);
+                if (mask) {
+                  candidate_energy += (*mask)(x, y);
+                }
+                if (seam->energy < 0 || candidate_energy < seam->energy) {
+                  res(x, y).energy = candidate_energy;
+                  res(x, y).parent = candidate_parent;
+                }
+              }
+            }
           }
-        }
-      }
-    }
+        },
+        kSeamBlock);
   }
 
   return res;
@@ -124,7 +124,7 @@ void draw_sierpinski(Image& img, vec3* fixed, int n_fixed, float alpha,
   progress.done();
 
   img = std::move(img.resize(width * 2, height * 2));
-  filters::Convolve(img, filters::Bloom(width * 2, height * 2));
+  filters::ConvolveSpectrum(img, filters::BloomSpectrum(width * 2, height * 2));
   img = std::move(img.resize(width, height));
 
   for (int i = 0; i < img.size(); ++i) {
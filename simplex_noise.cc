@@ -0,0 +1,105 @@
+#include "simplex_noise.h"
+
+#include <math.h>
+
+namespace {
+
+// Skewing and unskewing factors between the cubic and the simplex grids.
+const float kSkew = 1.0f / 3;
+const float kUnskew = 1.0f / 6;
+
+// Brings the sum of the 4 corners to [-1, 1].
+const float kScale = 76;
+
+// Midpoints of the edges of a cube.
+const float kGradients[12][3] = {
+    {1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0},
+    {1, 0, 1}, {-1, 0, 1}, {1, 0, -1}, {-1, 0, -1},
+    {0, 1, 1}, {0, -1, 1}, {0, 1, -1}, {0, -1, -1},
+};
+
+}  // namespace
+
+SimplexNoise::SimplexNoise() {
+  referencePermutation(perm_);
+  init();
+}
+
+SimplexNoise::SimplexNoise(unsigned int seed) {
+  randomPermutation(seed, perm_);
+  init();
+}
+
+void SimplexNoise::init() {
+  for (int i = 0; i < 512; ++i) {
+    grad_[i] = perm_[i] % 12;
+  }
+}
+
+float SimplexNoise::corner(int g, float x, float y, float z) {
+  float t = 0.5f - x * x - y * y - z * z;
+  if (t < 0) {
+    return 0;
+  }
+  t *= t;
+  const float* grad = kGradients[g];
+  return t * t * (grad[0] * x + grad[1] * y + grad[2] * z);
+}
+
+float SimplexNoise::noise(float x, float y, float z) const {
+  // Find the skewed unit cube that contains the point, and the offset from
+  // its origin in unskewed space.
+  float s = (x + y + z) * kSkew;
+  int i = floorf(x + s);
+  int j = floorf(y + s);
+  int k = floorf(z + s);
+  float t = (i + j + k) * kUnskew;
+  float x0 = x - (i - t);
+  float y0 = y - (j - t);
+  float z0 = z - (k - t);
+
+  // The cube has 6 tetrahedra, found by sorting the offset's coordinates.
+  // (i1, j1, k1) and (i2, j2, k2) are the offsets of the second and third
+  // corners.
+  int i1, j1, k1, i2, j2, k2;
+  if (x0 >= y0) {
+    if (y0 >= z0) {
+      i1 = 1, j1 = 0, k1 = 0, i2 = 1, j2 = 1, k2 = 0;
+    } else if (x0 >= z0) {
+      i1 = 1, j1 = 0, k1 = 0, i2 = 1, j2 = 0, k2 = 1;
+    } else {
+      i1 = 0, j1 = 0, k1 = 1, i2 = 1, j2 = 0, k2 = 1;
+    }
+  } else {
+    if (y0 < z0) {
+      i1 = 0, j1 = 0, k1 = 1, i2 = 0, j2 = 1, k2 = 1;
+    } else if (x0 < z0) {
+      i1 = 0, j1 = 1, k1 = 0, i2 = 0, j2 = 1, k2 = 1;
+    } else {
+      i1 = 0, j1 = 1, k1 = 0, i2 = 1, j2 = 1, k2 = 0;
+    }
+  }
+
+  float x1 = x0 - i1 + kUnskew;
+  float y1 = y0 - j1 + kUnskew;
+  float z1 = z0 - k1 + kUnskew;
+  float x2 = x0 - i2 + 2 * kUnskew;
+  float y2 = y0 - j2 + 2 * kUnskew;
+  float z2 = z0 - k2 + 2 * kUnskew;
+  float x3 = x0 - 1 + 3 * kUnskew;
+  float y3 = y0 - 1 + 3 * kUnskew;
+  float z3 = z0 - 1 + 3 * kUnskew;
+
+  // Hash the 4 corners to gradients.
+  int ii = i & 255;
+  int jj = j & 255;
+  int kk = k & 255;
+  int g0 = grad_[ii + perm_[jj + perm_[kk]]];
+  int g1 = grad_[ii + i1 + perm_[jj + j1 + perm_[kk + k1]]];
+  int g2 = grad_[ii + i2 + perm_[jj + j2 + perm_[kk + k2]]];
+  int g3 = grad_[ii + 1 + perm_[jj + 1 + perm_[kk + 1]]];
+
+  float res = corner(g0, x0, y0, z0) + corner(g1, x1, y1, z1) +
+              corner(g2, x2, y2, z2) + corner(g3, x3, y3, z3);
+  return (res * kScale + 1) / 2;
+}
@@ -0,0 +1,41 @@
+/***
+ * 3D simplex noise (Ken Perlin, 2001), following Stefan Gustavson's
+ * "Simplex noise demystified".
+ * Usage:
+ * #include "simplex_noise.h"
+ * SimplexNoise simplex;
+ * float value = simplex.noise(x, y, z);  // In [0, 1].
+ *
+ * Space is split into tetrahedra instead of cubes, and each sample sums
+ * radially fading gradient contributions of the 4 corners of its tetrahedron
+ * instead of interpolating between the 8 corners of a cube.
+ ***/
+
+#ifndef SIMPLEX_NOISE_H
+#define SIMPLEX_NOISE_H
+
+#include <stdint.h>
+
+#include "noise.h"
+
+class SimplexNoise : public Noise {
+ public:
+  // Uses the reference permutation.
+  SimplexNoise();
+  // Uses a random permutation generated from `seed`.
+  explicit SimplexNoise(unsigned int seed);
+
+  float noise(float x, float y, float z) const override;
+
+ private:
+  void init();
+
+  // Contribution of a corner with gradient `g` at offset (x, y, z).
+  static float corner(int g, float x, float y, float z);
+
+  // The permutation, twice, and its values modulo the 12 gradients.
+  uint8_t perm_[512];
+  uint8_t grad_[512];
+};
+
+#endif
@@ -0,0 +1,272 @@
+/***
+ * Statically dispatched SDFs.
+ * Usage:
+ * #include "static_sdf.h"
+ * namespace ssdf = static_sdf;
+ * auto cube = ssdf::Intersection(
+ *     ssdf::Translate(ssdf::Plane(vec3(1, 0, 0), material), vec3(1, 0, 0)),
+ *     ...);
+ * SDF* obj = scene->make<ssdf::Virtual<decltype(cube)>>(cube);
+ *
+ * Mirrors the combinators in sdf.h, but every node holds its children by value
+ * and knows their types, so a whole tree compiles into a single function which
+ * the compiler can inline and vectorize. Virtual turns a static tree into an
+ * SDF which can be added to a scene, and Ref embeds an existing SDF* in a
+ * static tree. The combinators return exactly what their sdf.h counterparts
+ * return, including the short-circuit bounds. Class names clash with sdf.h,
+ * so qualify them rather than importing the namespace.
+ ***/
+
+#ifndef STATIC_SDF_H
+#define STATIC_SDF_H
+
+#include <cmath>
+
+#include "color.h"
+#include "material.h"
+#include "range.h"
+#include "sdf.h"
+#include "vec3.h"
+
+namespace static_sdf {
+
+class Sphere {
+ public:
+  Sphere(const vec3& center, float radius, const Material& material)
+      : center(center), radius(radius), material(material) {}
+
+  SDFResult sdf(const vec3& v) const {
+    return SDFResult((v - center).len() - radius, material);
+  }
+
+ private:
+  vec3 center;
+  float radius;
+  Material material;
+};
+
+// The plane through the origin with the given normal.
+class Plane {
+ public:
+  Plane(const vec3& normal, const Material& material)
+      : normal(normal), material(material) {}
+
+  SDFResult sdf(const vec3& v) const {
+    return SDFResult(v.dot(normal), material);
+  }
+
+ private:
+  vec3 normal;
+  Material material;
+};
+
+// Embeds a virtual SDF. The SDF is not owned.
+class Ref {
+ public:
+  explicit Ref(const SDF* obj) : obj(obj) {}
+
+  SDFResult sdf(const vec3& v) const {
+    return obj->sdf(v);
+  }
+
+ private:
+  const SDF* obj;
+};
+
+template <class A, class B>
+class Union {
+ public:
+  Union(const A& obj1, const B& obj2) : obj1(obj1), obj2(obj2) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDFResult r1 = obj1.sdf(v);
+    if (r1.dist < 0) {
+      return r1;
+    }
+    SDFResult r2 = obj2.sdf(v);
+    return r1.dist < r2.dist ? r1 : r2;
+  }
+
+ private:
+  A obj1;
+  B obj2;
+};
+
+template <class A, class B>
+class Intersection {
+ public:
+  Intersection(const A& obj1, const B& obj2) : obj1(obj1), obj2(obj2) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDFResult r1 = obj1.sdf(v);
+    if (r1.dist > 1) {
+      return r1;
+    }
+    SDFResult r2 = obj2.sdf(v);
+    return r1.dist > r2.dist ? r1 : r2;
+  }
+
+ private:
+  A obj1;
+  B obj2;
+};
+
+template <class A, class B>
+class Smooth {
+ public:
+  Smooth(const A& obj1, const B& obj2, float k)
+      : obj1(obj1), obj2(obj2), k(k) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDFResult r1 = obj1.sdf(v);
+    SDFResult r2 = obj2.sdf(v);
+    float e1 = exp2(-k * r1.dist);
+    float e2 = exp2(-k * r2.dist);
+    float dist = -log2(e1 + e2) / k;
+    float alpha = e2 / (e1 + e2);
+    Material mat = r1.material;
+    mat.color_ = interpolate_colors(alpha, r1.material.color_, r2.material.color_);
+    mat.ambient = interpolate_floats(1 - alpha, r1.material.ambient, r2.material.ambient);
+    mat.diffuse = interpolate_floats(1 - alpha, r1.material.diffuse, r2.material.diffuse);
+    mat.reflect = interpolate_floats(1 - alpha, r1.material.reflect, r2.material.reflect);
+    return SDFResult(dist, mat);
+  }
+
+ private:
+  A obj1;
+  B obj2;
+  float k;
+};
+
+template <class T>
+class Periodic {
+ public:
+  Periodic(const T& child, const vec3& period) : child(child), period(period) {}
+
+  SDFResult sdf(const vec3& v) const {
+    return child.sdf(v.mod(period) - period * 0.5);
+  }
+
+ private:
+  T child;
+  vec3 period;
+};
+
+template <class T>
+class Translate {
+ public:
+  Translate(const T& child, const vec3& t) : child(child), t(t) {}
+
+  SDFResult sdf(const vec3& v) const {
+    return child.sdf(v - t);
+  }
+
+ private:
+  T child;
+  vec3 t;
+};
+
+template <class T>
+class Expand {
+ public:
+  Expand(const T& child, float r) : child(child), r(r) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDFResult res = child.sdf(v);
+    res.dist -= r;
+    return res;
+  }
+
+ private:
+  T child;
+  float r;
+};
+
+template <class T>
+class Scale {
+ public:
+  Scale(const T& child, float r) : child(child), r(r) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDFResult res = child.sdf(v / r);
+    res.dist *= r;
+    return res;
+  }
+
+ private:
+  T child;
+  float r;
+};
+
+template <class T>
+class PointwiseMultiply {
+ public:
+  PointwiseMultiply(const T& child, const vec3& t) : child(child), t(t) {}
+
+  SDFResult sdf(const vec3& v) const {
+    return child.sdf(vec3(v.x * t.x, v.y * t.y, v.z * t.z));
+  }
+
+ private:
+  T child;
+  vec3 t;
+};
+
+template <class T>
+class Negate {
+ public:
+  explicit Negate(const T& child) : child(child) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDFResult res = child.sdf(v);
+    res.dist = -res.dist;
+    return res;
+  }
+
+ private:
+  T child;
+};
+
+template <class T, class B>
+class Bound {
+ public:
+  Bound(const T& child, const B& bound_sdf, float bound_dist)
+      : child(child), bound_sdf(bound_sdf), bound_dist(bound_dist) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDFResult bound_res = bound_sdf.sdf(v);
+    if (bound_res.dist > bound_dist) {
+      return bound_res;
+    }
+    return child.sdf(v);
+  }
+
+ private:
+  T child;
+  B bound_sdf;
+  float bound_dist;
+};
+
+// Adapts a static tree to the virtual SDF interface. This is the only virtual
+// call made while evaluating the tree.
+template <class T>
+class Virtual : public SDF {
+ public:
+  explicit Virtual(const T& tree) : tree(tree) {}
+
+  SDFResult sdf(const vec3& v) const {
+    SDF_COUNTERS(static_sdf);
+    return tree.sdf(v);
+  }
+
+  const T& get() const {
+    return tree;
+  }
+
+ private:
+  T tree;
+};
+
+}  // namespace static_sdf
+
+#endif
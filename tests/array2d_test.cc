@@ -60,3 +60,213 @@ TEST_CASE("Resize", "[Array2D]") {
     CHECK(arr.resize(2, 2) == smaller);
     CHECK(arr.resize(4, 4) == larger);
 }
+
+TEST_CASE("Padded rows", "[Array2D]") {
+    CHECK(Array2D<float>::paddedPitch(1024) == 1040);
+    CHECK(Array2D<float>::paddedPitch(1000) == 1008);
+    CHECK(Array2D<float>::paddedPitch(1) == 16);
+    CHECK(Array2D<double>::paddedPitch(512) == 520);
+
+    Array2D<float> contiguous(37, 5);
+    Array2D<float> padded(37, 5, Array2D<float>::paddedPitch(37));
+    REQUIRE(padded.pitch() == 48);
+    CHECK(!padded.contiguous());
+    CHECK(reinterpret_cast<uintptr_t>(&padded(0, 0)) % 64 == 0);
+    CHECK(reinterpret_cast<uintptr_t>(&contiguous(0, 0)) % 64 == 0);
+    for (int y = 0; y < 5; ++y) {
+        CHECK(&padded(0, y + 1) - &padded(0, y) == 48);
+        for (int x = 0; x < 37; ++x) {
+            contiguous(x, y) = padded(x, y) = (x * 7 + y * 3) % 11 - 4.5;
+        }
+    }
+    CHECK(padded == contiguous);
+    CHECK(padded.column(3).str() == contiguous.column(3).str());
+    CHECK(padded.sum() == Approx(contiguous.sum()));
+    CHECK(padded.min() == contiguous.min());
+    CHECK(padded.max() == contiguous.max());
+    CHECK(padded.min() == -4.5);
+    CHECK(padded.max() == 5.5);
+
+    Array2D<float> copy(padded);
+    CHECK(copy.pitch() == 48);
+    copy += contiguous;
+    copy *= 0.5f;
+    copy *= contiguous;
+    copy /= 2;
+    contiguous += padded;
+    for (int y = 0; y < 5; ++y) {
+        for (int x = 0; x < 37; ++x) {
+            CHECK(copy(x, y) == Approx(padded(x, y) * padded(x, y) / 2));
+            CHECK(contiguous(x, y) == 2 * padded(x, y));
+        }
+    }
+
+    padded.serialize("/tmp/delme");
+    Array2D<float> loaded(37, 5);
+    loaded.deserialize("/tmp/delme");
+    CHECK(loaded == padded);
+    CHECK(padded.resize(40, 4).resize(37, 4) == loaded.resize(37, 4));
+
+    padded = 5.0f;
+    for (int y = 0; y < 5; ++y) {
+        for (int x = 0; x < 37; ++x) {
+            CHECK(padded(x, y) == 5);
+        }
+    }
+    CHECK(padded.sum() == 5 * 37 * 5);
+    padded.clear();
+    CHECK(padded.max() == 0);
+}
+
+TEST_CASE("Sum, min and max cover the ends of rows", "[Array2D]") {
+    for (int width : {1, 7, 8, 9, 17}) {
+        Array2D<int> arr(width, 3);
+        for (int i = 0; i < arr.size(); ++i) {
+            arr(i) = i % 5 == 0 ? i : -i;
+        }
+        arr(width - 1, 2) = 1000;
+        int expected_sum = 0;
+        for (int i = 0; i < arr.size(); ++i) {
+            expected_sum += arr(i);
+        }
+        CHECK(arr.sum() == expected_sum);
+        CHECK(arr.max() == 1000);
+        CHECK(arr.min() == *std::min_element(&arr(0), &arr(0) + arr.size()));
+    }
+}
+
+TEST_CASE("Arithmetic expressions are computed in a single pass", "[Array2D]") {
+    Array2D<float> a(19, 3);
+    Array2D<float> b(19, 3, Array2D<float>::paddedPitch(19));
+    for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 19; ++x) {
+            a(x, y) = x - y;
+            b(x, y) = x * y + 1;
+        }
+    }
+
+    Array2D<float> average = (a + b) * 0.5f;
+    Array2D<float> nested = ((a + b) / 2 + a * 3) / 4;
+    for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 19; ++x) {
+            CHECK(average(x, y) == (a(x, y) + b(x, y)) * 0.5f);
+            CHECK(nested(x, y) ==
+                  ((a(x, y) + b(x, y)) / 2 + a(x, y) * 3) / 4);
+        }
+    }
+
+    // Same values as the compound assignments.
+    Array2D<float> compound(a);
+    compound += b;
+    compound /= 2;
+    Array2D<float> expected(a);
+    expected.iaverage(b);
+    CHECK(compound == expected);
+
+    // Assigning to an operand, and to an array of another size.
+    b = (a + b) * 0.5f;
+    CHECK(b == average);
+    CHECK(b.pitch() == Array2D<float>::paddedPitch(19));
+    Array2D<float> other(2, 2);
+    other = a * 1;
+    CHECK(other == a);
+}
+
+TEST_CASE("Expressions can be used as the arrays they compute", "[Array2D]") {
+    Array2D<float> a(5, 3);
+    Array2D<float> b(5, 3);
+    for (int i = 0; i < a.size(); ++i) {
+        a(i) = i;
+        b(i) = i % 3 + 1;
+    }
+
+    CHECK((a + b).sum() == a.sum() + b.sum());
+    CHECK((a * 2.0f).max() == 28);
+    CHECK((a + b).eval() == Array2D<float>(a + b));
+
+    // Element-wise product.
+    Array2D<float> product = a * b;
+    for (int i = 0; i < a.size(); ++i) {
+        CHECK(product(i) == a(i) * b(i));
+    }
+
+    // Writes show in later uses of the expression.
+    auto doubled = a * 2.0f;
+    doubled(0, 0) = 1;
+    doubled(4, 2) = -1;
+    CHECK(doubled(0, 0) == 1);
+    CHECK(doubled.min() == -1);
+    Array2D<float> copy = doubled;
+    CHECK(copy(0, 0) == 1);
+    CHECK(copy(1, 0) == 2);
+    Array2D<float> nested = doubled + b;
+    CHECK(nested(0, 0) == 2);
+    CHECK(nested(4, 2) == b(4, 2) - 1);
+    CHECK(a(0, 0) == 0);
+}
+
+TEST_CASE("Files have a header and can be mapped", "[Array2D]") {
+    Array2D<float> arr(37, 5, Array2D<float>::paddedPitch(37));
+    for (int y = 0; y < 5; ++y) {
+        for (int x = 0; x < 37; ++x) {
+            arr(x, y) = x * 0.5f - y;
+        }
+    }
+    arr.serialize("/tmp/delme");
+
+    size_t width = 0;
+    size_t height = 0;
+    REQUIRE(Array2D<float>::readDimensions("/tmp/delme", &width, &height));
+    CHECK(width == 37);
+    CHECK(height == 5);
+    CHECK(!Array2D<int>::readDimensions("/tmp/delme", &width, &height));
+    CHECK(!Array2D<double>::readDimensions("/tmp/delme", &width, &height));
+
+    Array2D<float> loaded(1, 1);
+    loaded.deserialize("/tmp/delme");
+    CHECK(loaded == arr);
+    CHECK(loaded.pitch() == arr.pitch());
+
+    Array2D<float> mapped(1, 1);
+    mapped.map("/tmp/delme", true);
+    CHECK(mapped == arr);
+    CHECK(mapped.pitch() == arr.pitch());
+    CHECK(reinterpret_cast<uintptr_t>(&mapped(0, 0)) % 64 == 0);
+    CHECK(mapped.sum() == Approx(arr.sum()));
+
+    // Changes to mapped arrays do not reach the file.
+    mapped(3, 2) = 100;
+    mapped *= 2;
+    Array2D<float> copy(mapped);
+    Array2D<float> moved(std::move(mapped));
+    CHECK(moved == copy);
+    CHECK(moved(3, 2) == 200);
+    Array2D<float> reloaded(1, 1);
+    reloaded.map("/tmp/delme");
+    CHECK(reloaded == arr);
+}
+
+TEST_CASE("Files without a header can still be read", "[Array2D]") {
+    const size_t dimensions[3] = {3, 2, 6};
+    const int values[6] = {1, 2, 3, 4, 5, 6};
+    {
+        std::ofstream file("/tmp/delme", std::ofstream::binary);
+        file.write((const char*)dimensions, sizeof(dimensions));
+        file.write((const char*)values, sizeof(values));
+    }
+    Array2D<int> expected({{1, 2, 3},
+                           {4, 5, 6}});
+    size_t width = 0;
+    size_t height = 0;
+    REQUIRE(Array2D<int>::readDimensions("/tmp/delme", &width, &height));
+    CHECK(width == 3);
+    CHECK(height == 2);
+    CHECK(!Array2D<double>::readDimensions("/tmp/delme", &width, &height));
+
+    Array2D<int> loaded(1, 1);
+    loaded.deserialize("/tmp/delme");
+    CHECK(loaded == expected);
+    Array2D<int> mapped(10, 10);
+    mapped.map("/tmp/delme");
+    CHECK(mapped == expected);
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+
+#include "../arena.h"
+#include "../counters.h"
+#include "../distance_cache.h"
+#include "../rand_utils.h"
+#include "../sdf.h"
+
+#include "catch.hpp"
+
+TEST_CASE("Distance cache is conservative and exact near the surface",
+          "[DistanceCache]") {
+  Arena arena;
+  Material material(Color(1, 1, 1));
+  Sphere* sphere = arena.make<Sphere>(vec3(1, 2, 3), 2, material);
+  SDF* planet = arena.make<PerlinDeformation>(sphere, 0.5, 0.3);
+
+  DistanceCache::Params params;
+  params.voxel_size = 0.1;
+  params.lipschitz = 1.5;
+  DistanceCache cache(planet, params);
+  CHECK(cache.numBricks() > 0);
+  CHECK(cache.bytes() <= params.max_bytes);
+
+  int near_surface = 0;
+  for (int i = 0; i < 10000; ++i) {
+    vec3 v = vec3(1, 2, 3) + vec3::random() * rand_range(0, 4);
+    float exact = planet->sdf(v).dist;
+    CHECK(cache.cachedDistance(v) <= exact + 1e-4);
+    SDFResult r = cache.sdf(v);
+    if (exact < 0.1) {
+      near_surface++;
+      CHECK(r.dist == exact);
+      CHECK(r.material.color_ == material.color_);
+    }
+  }
+
+  CHECK(near_surface > 0);
+
+  // Far from the surface the cache is used instead of the child.
+  CHECK(cache.cachedDistance(vec3(1, 2, 10)) > 3);
+}
+
+TEST_CASE("Distance cache fits in its memory budget", "[DistanceCache]") {
+  Arena arena;
+  Sphere* sphere = arena.make<Sphere>(vec3(), 5, Material());
+
+  DistanceCache::Params params;
+  params.voxel_size = 0.01;
+  params.max_bytes = 1 << 20;
+  DistanceCache cache(sphere, params);
+  CHECK(cache.bytes() <= params.max_bytes);
+  CHECK(cache.params().voxel_size > 0.01);
+}
+
+TEST_CASE("Distance cache only calls the child close to the surface",
+          "[DistanceCache]") {
+  Arena arena;
+  Sphere* sphere = arena.make<Sphere>(vec3(), 2, Material());
+  DistanceCache cache(sphere, DistanceCache::Params());
+
+  // Registers the counter.
+  cache.sdf(vec3(2, 0, 0));
+  for (float distance : {0.9, 1.2, 2.0}) {
+    INFO("distance " << distance);
+    unsigned long calls = COUNTERS_GLOBAL_VALUE(distance_cache_exact_sdf_calls);
+    for (int i = 0; i < 1000; ++i) {
+      cache.sdf(vec3::random() * (2 + distance));
+    }
+    CHECK(COUNTERS_GLOBAL_VALUE(distance_cache_exact_sdf_calls) == calls);
+  }
+}
@@ -202,3 +202,132 @@ TEST_CASE("Bloom convolution single point", "[FFT]") {
   golden.deserialize("tests/golden_bloom_single_point.img");
   CHECK_THAT(image, IsApproximatelyEqualTo(golden));
 }
+
+TEST_CASE("FFT plans match the DFT", "[FFT]") {
+  // Powers of two, mixed radix and Bluestein sizes.
+  for (size_t n : {1, 2, 4, 8, 32, 128, 512, 3, 6, 7, 12, 30, 49, 60, 100,
+                   1000, 11, 13, 97, 202}) {
+    INFO("n = " << n);
+    std::vector<Complex> data(n);
+    for (size_t i = 0; i < n; ++i) {
+      data[i] = Complex(sin(i * 0.7) + 0.1 * i, cos(i * 1.3));
+    }
+    std::vector<Complex> transformed = data;
+    const fft::Plan& plan = fft::Plan::get(n);
+    CHECK(&plan == &fft::Plan::get(n));
+    plan.forward(transformed.data());
+    for (size_t k = 0; k < n; ++k) {
+      std::complex<double> expected = 0;
+      for (size_t i = 0; i < n; ++i) {
+        expected += std::complex<double>(data[i]) *
+                    std::polar(1.0, -2 * M_PI * double(i * k % n) / n);
+      }
+      // Float rounding grows with the size.
+      const double margin = 1e-3 * (1 + n / 100.0);
+      CHECK(transformed[k].real() == Approx(expected.real()).margin(margin));
+      CHECK(transformed[k].imag() == Approx(expected.imag()).margin(margin));
+    }
+    plan.inverse(transformed.data());
+    for (size_t i = 0; i < n; ++i) {
+      CHECK(transformed[i].real() == Approx(data[i].real()).margin(1e-4));
+      CHECK(transformed[i].imag() == Approx(data[i].imag()).margin(1e-4));
+    }
+  }
+}
+
+TEST_CASE("Real FFTs match complex FFTs", "[FFT]") {
+  for (size_t n : {2, 4, 8, 64, 256, 6, 30, 22}) {
+    INFO("n = " << n);
+    std::vector<Complex> expected(n);
+    std::vector<Complex> packed(n / 2 + 1);
+    for (size_t i = 0; i < n; ++i) {
+      float x = sin(i * 0.7) + 0.1 * i;
+      expected[i] = x;
+      reinterpret_cast<float*>(packed.data())[i] = x;
+    }
+    fft::Plan::get(n).forward(expected.data());
+    const fft::RealPlan& plan = fft::RealPlan::get(n);
+    plan.forward(packed.data());
+    for (size_t k = 0; k <= n / 2; ++k) {
+      CHECK(packed[k].real() == Approx(expected[k].real()).margin(1e-3));
+      CHECK(packed[k].imag() == Approx(expected[k].imag()).margin(1e-3));
+    }
+    plan.inverse(packed.data());
+    for (size_t i = 0; i < n; ++i) {
+      CHECK(reinterpret_cast<float*>(packed.data())[i] ==
+            Approx(sin(i * 0.7) + 0.1 * i).margin(1e-4));
+    }
+  }
+
+  Array2D<float> arr(16, 8);
+  Array2D<Complex> complex_arr(16, 8);
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 16; ++x) {
+      arr(x, y) = x * y + cos(x + 2 * y);
+      complex_arr(x, y) = arr(x, y);
+    }
+  }
+  fft::fft2d(complex_arr);
+  Array2D<Complex> spectrum = fft::rfft2d_mt(arr);
+  REQUIRE(spectrum.width() == 9);
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 9; ++x) {
+      CHECK(spectrum(x, y).real() ==
+            Approx(complex_arr(x, y).real()).margin(1e-3));
+      CHECK(spectrum(x, y).imag() ==
+            Approx(complex_arr(x, y).imag()).margin(1e-3));
+    }
+  }
+  Array2D<float> restored = fft::irfft2d(spectrum);
+  for (int i = 0; i < arr.size(); ++i) {
+    CHECK(restored(i) == Approx(arr(i)).margin(1e-4));
+  }
+}
+
+TEST_CASE("Convolution handles the 3 channels independently", "[FFT]") {
+  // Odd widths take another path for blue (see ConvolveSpectrum).
+  auto [width, height] = GENERATE(std::make_pair(32, 16),
+                                  std::make_pair(30, 18),
+                                  std::make_pair(26, 11),
+                                  std::make_pair(27, 11),
+                                  std::make_pair(9, 4));
+  Image image(width, height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      image(x, y) = Color(sin(x * 0.3) + 1, (x + y) % 5, cos(y * 0.7) + 1);
+    }
+  }
+  ComplexArray2D filter = filters::Blur(width, height);
+
+  Image convolved = image;
+  filters::Convolve(convolved, filter);
+
+  // Direct circular convolution.
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      Color expected;
+      for (int fy = 0; fy < height; ++fy) {
+        for (int fx = 0; fx < width; ++fx) {
+          float f = filter(fx, fy).real();
+          const Color& c = image((x - fx + width) % width,
+                                 (y - fy + height) % height);
+          expected.r += f * c.r;
+          expected.g += f * c.g;
+          expected.b += f * c.b;
+        }
+      }
+      CHECK(convolved(x, y).r == Approx(expected.r).margin(1e-4));
+      CHECK(convolved(x, y).g == Approx(expected.g).margin(1e-4));
+      CHECK(convolved(x, y).b == Approx(expected.b).margin(1e-4));
+    }
+  }
+}
+
+TEST_CASE("next_fast_size skips large prime factors", "[FFT]") {
+  CHECK(fft::next_fast_size(1) == 1);
+  CHECK(fft::next_fast_size(1024) == 1024);
+  CHECK(fft::next_fast_size(1080) == 1080);
+  CHECK(fft::next_fast_size(1021) == 1024);
+  CHECK(fft::next_fast_size(97) == 98);
+  CHECK(fft::next_fast_size(121) == 125);
+}
@@ -0,0 +1,199 @@
+#include <cmath>
+
+#include "../filters.h"
+#include "../image.h"
+
+#include "catch.hpp"
+
+namespace {
+
+// Sum of the red channel over the pixels whose distance (in max norm) to
+// (x, y) is in [min_distance, max_distance).
+double ringEnergy(const Image& image, int x, int y, int min_distance,
+                  int max_distance) {
+  double res = 0;
+  for (int py = 0; py < image.height(); ++py) {
+    for (int px = 0; px < image.width(); ++px) {
+      int distance = std::max(std::abs(px - x), std::abs(py - y));
+      if (distance >= min_distance && distance < max_distance) {
+        res += image(px, py).r;
+      }
+    }
+  }
+  return res;
+}
+
+// The bloom main.cc applies, through the FFT.
+void fftBloom(Image& image) {
+  const int width = image.width();
+  const int height = image.height();
+  image = image.resize(width * 2, height * 2);
+  filters::Convolve(image, filters::Bloom(width * 2, height * 2));
+  image = image.resize(width, height);
+}
+
+}  // namespace
+
+TEST_CASE("Downsample averages 2x2 blocks", "[filters]") {
+  Image image(5, 3);
+  for (int i = 0; i < image.size(); ++i) {
+    image(i) = Color(i, 1, 0);
+  }
+  Image res = filters::Downsample(image);
+  REQUIRE(res.width() == 3);
+  REQUIRE(res.height() == 2);
+  CHECK(res(0, 0).r == Approx((0 + 1 + 5 + 6) / 4.));
+  CHECK(res(2, 0).r == Approx((4 + 9) / 4.));
+  CHECK(res(2, 1).r == Approx(14 / 4.));
+  CHECK(res(1, 1).g == Approx(0.5));
+}
+
+TEST_CASE("Upsample keeps constant images", "[filters]") {
+  Image image(3, 2);
+  for (int i = 0; i < image.size(); ++i) {
+    image(i) = Color(1, 2, 3);
+  }
+  Image res = filters::Upsample(image, 5, 4);
+  for (int i = 0; i < res.size(); ++i) {
+    CHECK(res(i).r == Approx(1));
+    CHECK(res(i).g == Approx(2));
+    CHECK(res(i).b == Approx(3));
+  }
+}
+
+TEST_CASE("Binomial blur is separable [1 4 6 4 1] / 16", "[filters]") {
+  Image image(9, 9);
+  image(4, 4) = Color(256, 0, 0);
+  filters::BinomialBlur(image);
+  const float weights[5] = {1, 4, 6, 4, 1};
+  for (int y = 0; y < 9; ++y) {
+    for (int x = 0; x < 9; ++x) {
+      bool inside = std::abs(x - 4) <= 2 && std::abs(y - 4) <= 2;
+      float expected = inside ? weights[x - 2] * weights[y - 2] : 0;
+      CHECK(image(x, y).r == Approx(expected));
+    }
+  }
+}
+
+TEST_CASE("Pyramid bloom spreads a point like Bloom", "[filters]") {
+  Image image(256, 256);
+  image(100, 130) = Color(1000, 0, 0);
+  Image expected(image);
+  fftBloom(expected);
+  filters::PyramidBloom(image);
+
+  CHECK(ringEnergy(image, 100, 130, 0, 256) ==
+        Approx(ringEnergy(expected, 100, 130, 0, 256)).epsilon(0.05));
+  CHECK(ringEnergy(image, 100, 130, 0, 1) ==
+        Approx(ringEnergy(expected, 100, 130, 0, 1)).epsilon(0.1));
+  for (int distance = 4; distance < 128; distance *= 2) {
+    INFO("distance " << distance);
+    CHECK(ringEnergy(image, 100, 130, distance, 2 * distance) ==
+          Approx(ringEnergy(expected, 100, 130, distance, 2 * distance))
+              .epsilon(0.2));
+  }
+  for (int i = 0; i < image.size(); ++i) {
+    CHECK(image(i).g == 0);
+    CHECK(image(i).b == 0);
+  }
+}
+
+TEST_CASE("Pyramid bloom draws streaks along Ray's spokes", "[filters]") {
+  Image image(256, 256);
+  image(128, 128) = Color(1000, 1000, 1000);
+  filters::PyramidBloom(image);
+  const float angle = M_PI / 8 - (2 * M_PI) / 100;
+  for (int distance : {12, 24, 48}) {
+    for (float spoke : {angle, angle + float(M_PI) / 4, angle - float(M_PI)}) {
+      INFO("distance " << distance << ", spoke " << spoke);
+      const Color& on = image(128 + lround(distance * cos(spoke)),
+                              128 + lround(distance * sin(spoke)));
+      const Color& off = image(128 + lround(distance * cos(spoke + 0.4)),
+                               128 + lround(distance * sin(spoke + 0.4)));
+      CHECK(on.r > 1.5 * off.r);
+    }
+  }
+}
+
+TEST_CASE("Pyramid bloom only spreads light above the threshold",
+          "[filters]") {
+  Image image(64, 64);
+  for (int i = 0; i < image.size(); ++i) {
+    image(i) = Color(0.5, 0.25, 1);
+  }
+  Image dim(image);
+  filters::PyramidBloom(dim, 1);
+  for (int i = 0; i < image.size(); ++i) {
+    CHECK(dim(i) == image(i));
+  }
+
+  image(32, 32) = Color(101, 0.25, 1);
+  filters::PyramidBloom(image, 1);
+  CHECK(image(32, 32).r < 100);
+  CHECK(image(34, 32).r > 0.5);
+  for (int i = 0; i < image.size(); ++i) {
+    CHECK(image(i).r >= 0.5);
+    CHECK(image(i).g == 0.25f);
+    CHECK(image(i).b == 1);
+  }
+}
+
+TEST_CASE("Convolve picks the cheapest way to convolve", "[filters]") {
+  const int width = 256;
+  const int height = 128;
+  Image image(width, height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      image(x, y) = Color(sin(x * 0.3) + 1, (x + y) % 5, cos(y * 0.7) + 1);
+    }
+  }
+
+  // A cross, which is not separable.
+  ComplexArray2D cross(width, height);
+  cross(0, 0) = 0.5;
+  cross(1, 0) = cross(width - 1, 0) = 0.125;
+  cross(0, 1) = cross(0, height - 1) = 0.125;
+  ComplexArray2D gaussian = filters::Gaussian(width, height, 1);
+  ComplexArray2D shifted(width, height);
+  shifted(width - 3, 2) = 1;
+
+  CHECK(filters::PlanConvolution(cross).method ==
+        filters::ConvolutionPlan::DIRECT);
+  CHECK(filters::PlanConvolution(shifted).method ==
+        filters::ConvolutionPlan::DIRECT);
+  CHECK(filters::PlanConvolution(gaussian).method ==
+        filters::ConvolutionPlan::SEPARABLE);
+  CHECK(filters::PlanConvolution(filters::Blur(width, height)).method ==
+        filters::ConvolutionPlan::FFT);
+  CHECK(filters::PlanConvolution(filters::Bloom(width, height)).method ==
+        filters::ConvolutionPlan::FFT);
+
+  for (ComplexArray2D* filter : {&cross, &gaussian, &shifted}) {
+    Image convolved(image);
+    filters::Convolve(convolved, *filter);
+    Image expected(image);
+    filters::ConvolveFFT(expected, *filter);
+    for (int i = 0; i < image.size(); ++i) {
+      CHECK(convolved(i).r == Approx(expected(i).r).margin(1e-4));
+      CHECK(convolved(i).g == Approx(expected(i).g).margin(1e-4));
+      CHECK(convolved(i).b == Approx(expected(i).b).margin(1e-4));
+    }
+  }
+  // The shift moves pixels 3 left and 2 down, wrapping around.
+  Image shifted_image(image);
+  filters::Convolve(shifted_image, shifted);
+  CHECK(shifted_image(0, 2) == image(3, 0));
+  CHECK(shifted_image(width - 1, 0) == image(2, height - 2));
+}
+
+TEST_CASE("Separable convolution wraps around", "[filters]") {
+  Image image(7, 5);
+  image(0, 0) = Color(1, 2, 3);
+  filters::ConvolveSeparable(image, {0.25, 0.5, 0.25}, {0.5, 0, 0.5});
+  CHECK(image(0, 1).r == Approx(0.25));
+  CHECK(image(0, 4).g == Approx(0.5));
+  CHECK(image(6, 1).b == Approx(0.375));
+  CHECK(image(1, 4).r == Approx(0.125));
+  CHECK(image(0, 0).r == 0);
+  CHECK(image(3, 2).r == 0);
+}
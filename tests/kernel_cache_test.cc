@@ -0,0 +1,91 @@
+#include <unistd.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include "../filters.h"
+#include "../image.h"
+#include "../kernel_cache.h"
+
+#include "catch.hpp"
+
+TEST_CASE("Kernels are built once per key", "[KernelCache]") {
+  KernelCache cache;
+  int built = 0;
+  auto make = [&built]() {
+    built++;
+    return filters::Blur(16, 8);
+  };
+  const KernelCache::Spectrum& spectrum = cache.get("blur", 16, 8, make);
+  CHECK(&cache.get("blur", 16, 8, make) == &spectrum);
+  CHECK(built == 1);
+
+  KernelCache::Spectrum expected = filters::Blur(16, 8);
+  fft::fft2d_mt(expected);
+  for (int i = 0; i < expected.size(); ++i) {
+    CHECK(spectrum(i).real() == Approx(expected(i).real()).margin(1e-5));
+    CHECK(spectrum(i).imag() == Approx(expected(i).imag()).margin(1e-5));
+  }
+}
+
+TEST_CASE("Kernels are reused across runs", "[KernelCache]") {
+  std::string directory =
+      "/tmp/kernel_cache_test_" + std::to_string(getpid());
+  int built = 0;
+  auto make = [&built]() {
+    built++;
+    return filters::Blur(16, 8);
+  };
+  KernelCache first_run;
+  first_run.setDirectory(directory);
+  const KernelCache::Spectrum& first = first_run.get("blur", 16, 8, make);
+  KernelCache cache;
+  cache.setDirectory(directory);
+  const KernelCache::Spectrum& second = cache.get("blur", 16, 8, make);
+  CHECK(built == 1);
+  CHECK(second == first);
+
+  // A different size under the same key is rebuilt.
+  KernelCache other;
+  other.setDirectory(directory);
+  other.get("blur", 8, 4, []() { return filters::Blur(8, 4); });
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Cached bloom matches the bloom convolution", "[KernelCache]") {
+  Image image(64, 32);
+  image(10, 20) = Color(100, 10, 1);
+  Image expected = image;
+  filters::Convolve(expected, filters::Bloom(64, 32));
+  filters::ConvolveSpectrum(image, filters::BloomSpectrum(64, 32));
+  CHECK(&filters::BloomSpectrum(64, 32) == &filters::BloomSpectrum(64, 32));
+  for (int i = 0; i < image.size(); ++i) {
+    CHECK(image(i).r == Approx(expected(i).r).margin(1e-5));
+    CHECK(image(i).b == Approx(expected(i).b).margin(1e-5));
+  }
+}
+
+TEST_CASE("Failed kernels are built again", "[KernelCache]") {
+  KernelCache cache;
+  auto fail = []() -> KernelCache::Spectrum {
+    throw std::runtime_error("no kernel");
+  };
+  CHECK_THROWS(cache.get("blur", 16, 8, fail));
+  CHECK(cache.size() == 0);
+  const KernelCache::Spectrum& spectrum =
+      cache.get("blur", 16, 8, []() { return filters::Blur(16, 8); });
+  CHECK(spectrum.width() == 16);
+  CHECK(spectrum.height() == 8);
+  CHECK(cache.size() == 1);
+}
+
+TEST_CASE("Kernels can be built while building another", "[KernelCache]") {
+  KernelCache cache;
+  cache.get("bloom", 16, 8, [&cache]() {
+    // Would deadlock if the cache stayed locked while building.
+    cache.get("blur", 16, 8, []() { return filters::Blur(16, 8); });
+    return filters::Bloom(16, 8);
+  });
+  CHECK(cache.size() == 2);
+}
@@ -0,0 +1,113 @@
+#include <cmath>
+#include <vector>
+
+#include "../noise_texture.h"
+#include "../perlin_noise.h"
+#include "../simplex_noise.h"
+#include "../rand_utils.h"
+
+#include "catch.hpp"
+
+TEST_CASE("Batched noise matches single point noise", "[PerlinNoise]") {
+  PerlinNoise reference;
+  PerlinNoise seeded(42);
+  // Not a multiple of 8, to cover the scalar tail.
+  const size_t n = 1003;
+  std::vector<float> x, y, z;
+  for (size_t i = 0; i < n; ++i) {
+    // Includes negative coordinates and coordinates beyond 256.
+    x.push_back(rand_range(-300, 300));
+    y.push_back(rand_range(-10, 10));
+    z.push_back(rand_range(0, 1000));
+  }
+  for (const PerlinNoise* perlin : {&reference, &seeded}) {
+    std::vector<float> batch(n), scalar(n);
+    perlin->noise(x.data(), y.data(), z.data(), batch.data(), n);
+    perlin->noiseScalar(x.data(), y.data(), z.data(), scalar.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      float expected = perlin->noise(x[i], y[i], z[i]);
+      CHECK(scalar[i] == expected);
+      CHECK(batch[i] == Approx(expected).margin(1e-6));
+    }
+  }
+}
+
+TEST_CASE("Reference noise values are unchanged", "[PerlinNoise]") {
+  PerlinNoise perlin;
+  CHECK(perlin.noise(0.3, 0.7, 0.1) == Approx(0.447811842));
+  CHECK(perlin.noise(12.5, -3.25, 7.75) == Approx(0.411139488));
+  CHECK(perlin.noise(-100.1, 42.2, 300.3) == Approx(0.671309054));
+}
+
+TEST_CASE("Fractal noise levels of detail", "[PerlinNoise]") {
+  PerlinNoise perlin;
+  CHECK(PerlinNoise::detail(0, 5) == 5);
+  CHECK(PerlinNoise::detail(1, 5) == 1);
+  CHECK(PerlinNoise::detail(1.0 / 8, 5) == Approx(3));
+  CHECK(PerlinNoise::detail(1e-6, 5) == 5);
+
+  for (int i = 0; i < 1000; ++i) {
+    float x = rand_range(-50, 50);
+    float y = rand_range(-50, 50);
+    float z = rand_range(-50, 50);
+    CHECK(perlin.fbm(x, y, z, 1, 1) == perlin.noise(x, y, z));
+    float full = perlin.fbm(x, y, z, 5, 5);
+    float coarse = perlin.fbm(x, y, z, 5, 1);
+    CHECK(full >= 0);
+    CHECK(full <= 1);
+    // Each octave i contributes at most 2^-i / (2 - 2^-4) to the sum.
+    CHECK(std::abs(full - coarse) <= (1 - 1.0 / 16) / (2 - 1.0 / 16) + 1e-5);
+    // Fractional detail blends between the neighbouring integer ones.
+    float two = perlin.fbm(x, y, z, 5, 2);
+    float three = perlin.fbm(x, y, z, 5, 3);
+    CHECK(perlin.fbm(x, y, z, 5, 2.5) == Approx((two + three) / 2).margin(1e-5));
+  }
+}
+
+TEST_CASE("Simplex noise", "[SimplexNoise]") {
+  SimplexNoise simplex;
+  CHECK(Noise::get(Noise::SIMPLEX)->noise(1.5, 2.25, 3.75) ==
+        simplex.noise(1.5, 2.25, 3.75));
+  CHECK(simplex.noise(1.5, 2.25, 3.75) !=
+        SimplexNoise(1).noise(1.5, 2.25, 3.75));
+
+  double mean = 0;
+  const int n = 10000;
+  for (int i = 0; i < n; ++i) {
+    float x = rand_range(-300, 300);
+    float y = rand_range(-300, 300);
+    float z = rand_range(-300, 300);
+    float value = simplex.noise(x, y, z);
+    CHECK(value >= 0);
+    CHECK(value <= 1);
+    mean += value;
+    // Continuous, also across the simplex boundaries.
+    CHECK(simplex.noise(x + 1e-3, y, z) == Approx(value).margin(0.01));
+    CHECK(simplex.fbm(x, y, z, 1, 1) == value);
+  }
+  CHECK(mean / n == Approx(0.5).margin(0.01));
+}
+
+TEST_CASE("Baked noise textures tile and match the noise", "[NoiseTexture]") {
+  PerlinNoise perlin;
+  NoiseTexture::Params params;
+  params.resolution = 64;
+  params.period = 8;
+  NoiseTexture texture(perlin, params);
+  CHECK(texture.bytes() == 64 * 64 * 64 * sizeof(float));
+
+  for (int i = 0; i < 1000; ++i) {
+    float x = rand_range(-300, 300);
+    float y = rand_range(-300, 300);
+    float z = rand_range(-300, 300);
+    CHECK(perlin.periodicNoise(x, y, z, 256) == perlin.noise(x, y, z));
+    float value = perlin.periodicNoise(x, y, z, 8);
+    CHECK(perlin.periodicNoise(x + 8, y - 16, z + 80, 8) ==
+          Approx(value).margin(1e-4));
+    CHECK(texture.noise(x, y, z) == Approx(value).margin(0.03));
+    CHECK(texture.noise(x - 8, y + 24, z) ==
+          Approx(texture.noise(x, y, z)).margin(1e-4));
+  }
+  // 8 samples per noise cell.
+  CHECK(texture.maxError(10000) < 0.03);
+}
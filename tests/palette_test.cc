@@ -0,0 +1,98 @@
+#include <cmath>
+#include <vector>
+
+#include "../array2d.h"
+#include "../color.h"
+#include "../image.h"
+#include "../palette.h"
+#include "../rand_utils.h"
+
+#include "catch.hpp"
+
+namespace {
+
+// The original linear scan.
+Color linearColor(const std::vector<Palette::Key>& keys, double val) {
+  for (int i = 0; i < keys.size(); ++i) {
+    if (val < keys[i].val) {
+      if (i == 0) {
+        return keys[0].color;
+      }
+      const Palette::Key& a = keys[i - 1];
+      const Palette::Key& b = keys[i];
+      double alpha = interpolate(val, Range(a.val, b.val), Range());
+      return interpolate_colors(alpha, a.color, b.color);
+    }
+  }
+  return keys[keys.size() - 1].color;
+}
+
+}  // namespace
+
+TEST_CASE("Binary search matches a linear scan", "[Palette]") {
+  std::vector<Palette::Key> keys;
+  Palette palette;
+  for (int i = 0; i < 100; ++i) {
+    keys.push_back(Palette::Key(i * 0.01 + (i % 3) * 0.002,
+                                Color(rand_range(0, 1), rand_range(0, 1),
+                                      rand_range(0, 1))));
+    palette.addKey(keys.back());
+  }
+  for (int i = 0; i < 10000; ++i) {
+    double val = rand_range(-0.5, 1.5);
+    CHECK(palette.color(val) == linearColor(keys, val));
+  }
+  CHECK(palette.color(keys[10].val) == linearColor(keys, keys[10].val));
+  CHECK(palette.color(NAN) == keys.back().color);
+}
+
+TEST_CASE("Compiled palettes are close to exact ones", "[Palette]") {
+  for (const Palette& exact :
+       {Palette::RedHot(), Palette::Rainbow(), Palette::Veridis()}) {
+    Palette compiled = exact.compiled();
+    CHECK(compiled.isCompiled());
+    CHECK(!exact.isCompiled());
+    for (int i = 0; i < 10000; ++i) {
+      double val = rand_range(-0.5, 1.5);
+      Color a = exact.color(val);
+      Color b = compiled.color(val);
+      CHECK(a.r == Approx(b.r).margin(0.01));
+      CHECK(a.g == Approx(b.g).margin(0.01));
+      CHECK(a.b == Approx(b.b).margin(0.01));
+    }
+  }
+}
+
+TEST_CASE("Batch conversion matches single values", "[Palette]") {
+  // Not a multiple of 8, to cover the scalar tail.
+  std::vector<float> vals;
+  for (int i = 0; i < 1003; ++i) {
+    vals.push_back(rand_range(-0.5, 1.5));
+  }
+  vals[5] = NAN;
+  for (const Palette& palette :
+       {Palette::Rainbow(), Palette::Rainbow().compiled(256)}) {
+    std::vector<Color> colors(vals.size());
+    palette.colors(vals.data(), vals.size(), colors.data());
+    for (size_t i = 0; i < vals.size(); ++i) {
+      CHECK(colors[i] == palette.color(vals[i]));
+    }
+  }
+}
+
+TEST_CASE("Images from float arrays with padded rows", "[Palette]") {
+  Array2D<float> contiguous(5, 3);
+  Array2D<float> padded(5, 3, Array2D<float>::paddedPitch(5));
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 5; ++x) {
+      contiguous(x, y) = padded(x, y) = x + y * 5 + 1;
+    }
+  }
+  Image image = Image::fromFloatArray(padded);
+  Image expected = Image::fromFloatArray(contiguous);
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 5; ++x) {
+      CHECK(image(x, y) == expected(x, y));
+    }
+  }
+}
@@ -0,0 +1,154 @@
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <vector>
+
+#include "../color.h"
+#include "../image.h"
+#include "../pixels.h"
+#include "../rand_utils.h"
+
+#include "catch.hpp"
+
+namespace {
+
+// Random colors over many magnitudes, with some special values.
+std::vector<Color> testColors() {
+  std::vector<Color> colors;
+  for (int i = 0; i < 1001; ++i) {
+    float scale = pow(2, rand_range(-30, 20));
+    colors.push_back(Color(rand_range(-1, 1) * scale, rand_range(0, 1) * scale,
+                           rand_range(0, 1) * scale * 0.01));
+  }
+  const float inf = std::numeric_limits<float>::infinity();
+  colors.push_back(Color(0, -0.f, 1));
+  colors.push_back(Color(65504, 65519, 65520));
+  colors.push_back(Color(inf, -inf, 1e-8));
+  colors.push_back(Color(65408, 70000, 0.5));
+  colors.push_back(Color(511.9, 1, 0));
+  return colors;
+}
+
+}  // namespace
+
+TEST_CASE("Half floats round to nearest, ties to even", "[Pixels]") {
+  using pixels::floatToHalf;
+  using pixels::halfToFloat;
+  CHECK(floatToHalf(0) == 0);
+  CHECK(floatToHalf(-0.f) == 0x8000);
+  CHECK(floatToHalf(1) == 0x3c00);
+  CHECK(floatToHalf(-2) == 0xc000);
+  CHECK(floatToHalf(65504) == 0x7bff);
+  CHECK(floatToHalf(65519) == 0x7bff);
+  CHECK(floatToHalf(65520) == 0x7c00);
+  CHECK(floatToHalf(1e10) == 0x7c00);
+  CHECK(floatToHalf(std::nanf("")) >= 0x7c01);
+  // 1 + 2^-11 is halfway between 1 and the next half, 1 + 2^-10.
+  CHECK(floatToHalf(1 + pow(2, -11)) == 0x3c00);
+  CHECK(floatToHalf(1 + 3 * pow(2, -11)) == 0x3c02);
+  // Denormals, down to 2^-24.
+  CHECK(floatToHalf(pow(2, -24)) == 1);
+  CHECK(floatToHalf(pow(2, -26)) == 0);
+  CHECK(floatToHalf(3 * pow(2, -25)) == 2);
+
+  for (uint32_t half = 0; half < 0x10000; ++half) {
+    if ((half & 0x7c00) == 0x7c00 && (half & 0x3ff) != 0) {
+      CHECK(std::isnan(halfToFloat(half)));
+      continue;
+    }
+    INFO("half " << half);
+    CHECK(floatToHalf(halfToFloat(half)) == half);
+  }
+}
+
+TEST_CASE("RGB9E5 keeps 9 bits of the largest channel", "[Pixels]") {
+  CHECK(RGB9E5(Color(0, 0, 0)).bits == 0);
+  CHECK(Color(RGB9E5(Color(1, 0.5, 0.25))) == Color(1, 0.5, 0.25));
+  CHECK(Color(RGB9E5(Color(-1, 1e6, std::nanf("")))) == Color(0, 65408, 0));
+  // 511.9 rounds to 512, which needs the next exponent, in steps of 2.
+  CHECK(Color(RGB9E5(Color(511.9, 1, 0))) == Color(512, 2, 0));
+  for (const Color& color : testColors()) {
+    Color decoded = RGB9E5(color);
+    const Color clamped(pixels::clampChannel(color.r),
+                        pixels::clampChannel(color.g),
+                        pixels::clampChannel(color.b));
+    // Half a step, which is at least 2^-24.
+    const float margin =
+        std::max(std::max({decoded.r, decoded.g, decoded.b}) / 512,
+                 float(pow(2, -25)));
+    INFO(color << " -> " << decoded);
+    CHECK(decoded.r == Approx(clamped.r).margin(margin));
+    CHECK(decoded.g == Approx(clamped.g).margin(margin));
+    CHECK(decoded.b == Approx(clamped.b).margin(margin));
+  }
+}
+
+TEST_CASE("Batch conversions match the per pixel ones", "[Pixels]") {
+  std::vector<Color> colors = testColors();
+  for (Color& color : colors) {
+    // Also values in [0, 1] and around, for 8 bit pixels.
+    if (rand_range(0, 1) < 0.5) {
+      color = Color(rand_range(-0.1, 1.1), rand_range(0, 1), rand_range(0, 1));
+    }
+  }
+  const size_t n = colors.size();
+  std::vector<Half3> halves(n);
+  std::vector<RGB9E5> shared(n);
+  std::vector<RGB> bytes(n);
+  pixels::pack(colors.data(), n, halves.data());
+  pixels::pack(colors.data(), n, shared.data());
+  pixels::pack(colors.data(), n, bytes.data());
+  std::vector<Color> from_halves(n);
+  std::vector<Color> from_shared(n);
+  std::vector<Color> from_bytes(n);
+  pixels::unpack(halves.data(), n, from_halves.data());
+  pixels::unpack(shared.data(), n, from_shared.data());
+  pixels::unpack(bytes.data(), n, from_bytes.data());
+  for (size_t i = 0; i < n; ++i) {
+    INFO("color " << colors[i]);
+    CHECK(halves[i] == Half3(colors[i]));
+    CHECK(shared[i] == RGB9E5(colors[i]));
+    RGB rgb(colors[i]);
+    CHECK(int(bytes[i].r) == rgb.r);
+    CHECK(int(bytes[i].g) == rgb.g);
+    CHECK(int(bytes[i].b) == rgb.b);
+    CHECK(from_halves[i] == Color(halves[i]));
+    CHECK(from_shared[i] == Color(shared[i]));
+    CHECK(from_bytes[i] == Color(bytes[i]));
+  }
+}
+
+TEST_CASE("Packed images round trip through files", "[Pixels]") {
+  Image image(37, 5);
+  for (int i = 0; i < image.size(); ++i) {
+    image(i) = Color(i * 0.25, i % 3, 1000.0 / (i + 1));
+  }
+  image.serialize("/tmp/delme");
+  const auto full_size = std::filesystem::file_size("/tmp/delme");
+
+  HalfImage half(image);
+  half.serialize("/tmp/delme_half");
+  CHECK(std::filesystem::file_size("/tmp/delme_half") < full_size / 2 + 64);
+  HalfImage loaded_half(0, 0);
+  loaded_half.map("/tmp/delme_half", true);
+  CHECK(loaded_half == half);
+  size_t width, height;
+  CHECK(!RGB9E5Image::readDimensions("/tmp/delme_half", &width, &height));
+  CHECK(!Image::readDimensions("/tmp/delme_half", &width, &height));
+
+  RGB9E5Image shared(image);
+  shared.serialize("/tmp/delme");
+  CHECK(std::filesystem::file_size("/tmp/delme") < full_size / 3 + 64);
+  RGB9E5Image loaded_shared(0, 0);
+  loaded_shared.deserialize("/tmp/delme");
+  CHECK(loaded_shared == shared);
+
+  Image from_half = loaded_half.unpack();
+  Image from_shared = loaded_shared.unpack();
+  for (int i = 0; i < image.size(); ++i) {
+    CHECK(from_half(i).r == Approx(image(i).r).epsilon(1e-3));
+    CHECK(from_half(i).b == Approx(image(i).b).epsilon(1e-3));
+    CHECK(from_shared(i).b == Approx(image(i).b).margin(1000.0 / 256));
+  }
+  CHECK(Image8(image).unpack()(4) == Color(RGB(image(4))));
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../scenes/scene_file.h"
+
+#include "catch.hpp"
+
+const char* kSceneFile = R"(
+# Two scenes; only the requested one is built.
+scene First {
+  params { reflection_depth 2; eye_pos 1 2 3; use_gravity true; }
+  material red { color 1 0 0; ambient 0.25; }
+  colorizer checkers checkerboard { color1 1 1 1; color2 0xff0000; scale 0.5; }
+  material floor { colorizer checkers; reflect 0.9; }
+  union {
+    sphere { center -2 0 20; radius 1.5; material red; }
+    sphere { center 2 0 20; radius 1.5; material red; }
+  }
+  translate { offset 0 -2 0; plane { normal 0 1 0; material floor; } }
+  light point { position -10 10 20; }
+  light spot { position 0 10 0; direction 0 -1 0; angle 0.5; }
+  mass { position 0 0 20; mass 0.001; }
+}
+
+scene Second {
+  # Unknown types are never looked at unless this scene is requested.
+  not_a_real_object { foo 1 2 3; }
+}
+)";
+
+void CheckFirstScene(Scene* scene) {
+  REQUIRE(scene != 0);
+  CHECK(scene->name() == "First");
+  CHECK(scene->rendering_params().reflection_depth == 2);
+  CHECK(scene->rendering_params().camera_settings.eye_pos.y == Approx(2));
+  CHECK(scene->rendering_params().use_gravity);
+  CHECK(scene->lights().size() == 2);
+  CHECK(scene->masses().size() == 1);
+
+  SDFResult r = scene->root()->sdf(vec3(-2, 0, 17));
+  CHECK(r.dist == Approx(1.5));
+  CHECK(r.material.color_ == Color(1, 0, 0));
+  CHECK(r.material.ambient == Approx(0.25));
+
+  r = scene->root()->sdf(vec3(0, -1, 0));
+  CHECK(r.dist == Approx(1));
+  CHECK(r.material.reflect == Approx(0.9));
+}
+
+TEST_CASE("Scene files can be parsed and built", "[SceneFile]") {
+  std::istringstream in(kSceneFile);
+  CHECK(!scene_file::IsCompiled(in));
+  Scene* scene = scene_file::LoadScene(in, "First");
+  CheckFirstScene(scene);
+  delete scene;
+
+  std::istringstream in2(kSceneFile);
+  CHECK(scene_file::LoadScene(in2, "Missing") == 0);
+
+  std::istringstream in3(kSceneFile);
+  CHECK(scene_file::ListScenes(in3) ==
+        std::vector<std::string>{"First", "Second"});
+}
+
+TEST_CASE("Compiled scene files load the same scenes", "[SceneFile]") {
+  std::istringstream in(kSceneFile);
+  std::stringstream compiled;
+  scene_file::CompileSceneFile(in, compiled);
+
+  CHECK(scene_file::IsCompiled(compiled));
+  CHECK(scene_file::ListScenes(compiled) ==
+        std::vector<std::string>{"First", "Second"});
+
+  compiled.clear();
+  compiled.seekg(0);
+  Scene* scene = scene_file::LoadScene(compiled, "First");
+  CheckFirstScene(scene);
+  delete scene;
+}
+
+TEST_CASE("Repeated rendering params use their last value", "[SceneFile]") {
+  std::istringstream in(R"(
+scene Repeated {
+  params { reflection_depth 2; epsilon 0.5; reflection_depth 3; }
+}
+)");
+  Scene* scene = scene_file::LoadScene(in, "Repeated");
+  REQUIRE(scene != 0);
+  CHECK(scene->rendering_params().reflection_depth == 3);
+  CHECK(scene->rendering_params().epsilon == Approx(0.5));
+  delete scene;
+}
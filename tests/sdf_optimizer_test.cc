@@ -0,0 +1,99 @@
+#include <iostream>
+
+#include "../arena.h"
+#include "../sdf.h"
+#include "../sdf_optimizer.h"
+
+#include "catch.hpp"
+
+TEST_CASE("Optimized SDFs match the original SDFs", "[SDFOptimizer]") {
+  Arena arena;
+  Material red(Color(1, 0, 0));
+  Material green(Color(0, 1, 0));
+
+  // Translate(Scale(Translate(Plane))), as in cube_scene.cc.
+  SDF* floor = arena.make<Plane>(vec3(0, 1, 0), vec3(1, 0, 0), vec3(0, 0, 1),
+                                 green);
+  floor = arena.make<Translate>(floor, vec3(0, 1, 0));
+  floor = arena.make<Scale>(floor, 2);
+  floor = arena.make<Translate>(floor, vec3(3, -4, 5));
+
+  SDF* ball = arena.make<Sphere>(vec3(1, 2, 3), 1.5, red);
+  ball = arena.make<Translate>(ball, vec3(-1, 0, 2));
+  ball = arena.make<Scale>(ball, 0.5);
+
+  SDF* squashed = arena.make<Sphere>(vec3(0, 0, 0), 1, red);
+  squashed = arena.make<PointwiseMultiply>(squashed, vec3(1, 2, 1));
+  squashed = arena.make<Translate>(squashed, vec3(0, 0, 0));
+  squashed = arena.make<Translate>(squashed, vec3(2, 2, 2));
+  squashed = arena.make<Negate>(arena.make<Negate>(squashed));
+  squashed = arena.make<Expand>(squashed, 0);
+
+  SDF* nested = arena.make<Union>(arena.make<Union>(floor, ball), squashed);
+  MultiUnion* root = arena.make<MultiUnion>();
+  root->addChild(nested);
+
+  std::vector<vec3> points;
+  std::vector<SDFResult> expected;
+  for (int i = 0; i < 1000; ++i) {
+    points.push_back(vec3::random() * 10);
+    expected.push_back(root->sdf(points.back()));
+  }
+
+  int before = SDFOptimizer::countNodes(root);
+  SDFOptimizer optimizer(&arena);
+  optimizer.optimize(root);
+  int after = SDFOptimizer::countNodes(root);
+
+  // MultiUnion(Plane, Sphere, Affine(Sphere)).
+  CHECK(before == 17);
+  CHECK(after == 5);
+
+  for (size_t i = 0; i < points.size(); ++i) {
+    SDFResult r = root->sdf(points[i]);
+    CHECK(r.dist == Approx(expected[i].dist).margin(1e-4));
+    CHECK(r.material.color_ == expected[i].material.color_);
+  }
+}
+
+TEST_CASE("Bounds contain the surface", "[SDFOptimizer]") {
+  Arena arena;
+  Material material(Color(1, 1, 1));
+
+  Sphere* sphere = arena.make<Sphere>(vec3(1, 2, 3), 2, material);
+  SDF* planet = arena.make<PerlinDeformation>(sphere, 2, 0.5);
+  planet = arena.make<Scale>(arena.make<Translate>(planet, vec3(1, 0, 0)), 2);
+  AABB box = planet->bounds();
+  CHECK(box.min.x == Approx(2 * (1 - 2 - 0.5 + 1)));
+  CHECK(box.max.z == Approx(2 * (3 + 2 + 0.5)));
+
+  SDF* plane = arena.make<Plane>(vec3(0, 1, 0), vec3(1, 0, 0), vec3(0, 0, 1),
+                                 material);
+  CHECK(!plane->bounds().isFinite());
+  CHECK(arena.make<Intersection>(plane, sphere)->bounds().isFinite());
+  CHECK(!arena.make<Union>(plane, sphere)->bounds().isFinite());
+
+  MultiUnion* root = arena.make<MultiUnion>();
+  root->addChild(planet);
+  root->addChild(plane);
+  std::vector<vec3> points;
+  std::vector<float> expected;
+  for (int i = 0; i < 1000; ++i) {
+    points.push_back(vec3::random() * 30);
+    expected.push_back(root->sdf(points.back()).dist);
+  }
+
+  SDFOptimizer optimizer(&arena);
+  optimizer.addBounds(root);
+  CHECK(SDFOptimizer::countNodes(root) == 7);
+
+  for (size_t i = 0; i < points.size(); ++i) {
+    float dist = root->sdf(points[i]).dist;
+    // Bounds may only make the distance more conservative, and only far from
+    // the surface.
+    CHECK(dist <= expected[i] + 1e-4);
+    if (dist < expected[i] - 1e-4) {
+      CHECK(dist > 0.1);
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#include <iostream>
+
+#include "../rand_utils.h"
+#include "../sdf.h"
+#include "../static_sdf.h"
+
+#include "catch.hpp"
+
+namespace ssdf = static_sdf;
+
+TEST_CASE("Static SDFs match virtual SDFs", "[StaticSDF]") {
+  Material red(Color(1, 0, 0));
+  Material green(Color(0, 1, 0));
+
+  ::Sphere s1(vec3(0, 0, 0), 1.5, red);
+  ::Sphere s2(vec3(1, 0, 0), 1, green);
+  ::Plane plane(vec3(0, 1, 0), vec3(1, 0, 0), vec3(0, 0, 1), green);
+  ::Translate floor(&plane, vec3(0, -2, 0));
+  ::Negate hole(&s2);
+  ::Intersection chopped(&s1, &hole);
+  ::Scale scaled(&chopped, 2);
+  ::Smooth smooth(&scaled, &floor, 2);
+  ::Union virtual_tree(&smooth, &s2);
+
+  auto static_tree = ssdf::Union(
+      ssdf::Smooth(
+          ssdf::Scale(ssdf::Intersection(ssdf::Sphere(vec3(0, 0, 0), 1.5, red),
+                                         ssdf::Negate(ssdf::Ref(&s2))),
+                      2),
+          ssdf::Translate(ssdf::Plane(vec3(0, 1, 0), green), vec3(0, -2, 0)),
+          2),
+      ssdf::Sphere(vec3(1, 0, 0), 1, green));
+  ssdf::Virtual<decltype(static_tree)> adapted(static_tree);
+
+  for (int i = 0; i < 1000; ++i) {
+    vec3 v = vec3::random() * 5;
+    SDFResult expected = virtual_tree.sdf(v);
+    SDFResult actual = adapted.sdf(v);
+    CHECK(actual.dist == Approx(expected.dist));
+    CHECK(actual.material.color_ == expected.material.color_);
+  }
+}
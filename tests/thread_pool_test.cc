@@ -0,0 +1,56 @@
+#include <atomic>
+#include <vector>
+
+#include "../thread_pool.h"
+
+#include "catch.hpp"
+
+TEST_CASE("parallelFor covers the range once", "[ThreadPool]") {
+  ThreadPool pool(3);
+  for (int block : {0, 1, 7, 1000}) {
+    std::vector<std::atomic<int>> calls(1000);
+    pool.parallelFor(
+        10, 1000,
+        [&calls](int begin, int end) {
+          for (int i = begin; i < end; ++i) {
+            calls[i]++;
+          }
+        },
+        block);
+    for (int i = 0; i < 1000; ++i) {
+      CHECK(calls[i] == (i < 10 ? 0 : 1));
+    }
+  }
+  pool.parallelFor(5, 5, [](int begin, int end) { FAIL("empty range"); });
+}
+
+TEST_CASE("parallelFor can be nested and called from tasks", "[ThreadPool]") {
+  ThreadPool pool(2);
+  std::atomic<int> sum = 0;
+  auto nested = [&pool, &sum]() {
+    pool.parallelFor(0, 10, [&pool, &sum](int begin, int end) {
+      for (int i = begin; i < end; ++i) {
+        pool.parallelFor(0, 10, [&sum](int begin, int end) {
+          sum += end - begin;
+        }, 1);
+      }
+    }, 1);
+  };
+  std::future<void> task1 = pool.submit(nested);
+  std::future<void> task2 = pool.submit(nested);
+  nested();
+  task1.wait();
+  task2.wait();
+  CHECK(sum == 300);
+}
+
+TEST_CASE("The global pool runs parallel_for", "[ThreadPool]") {
+  CHECK(GlobalThreadPool::instance().numThreads() >= 1);
+  std::atomic<int> sum = 0;
+  parallel_for(0, 100, [&sum](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      sum += i;
+    }
+  });
+  CHECK(sum == 4950);
+}
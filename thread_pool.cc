@@ -0,0 +1,113 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "absl/flags/flag.h"
+
+ABSL_FLAG(int, num_threads, 0,
+          "number of worker threads used for rendering and image processing, "
+          "0 for one per core");
+
+ThreadPool::ThreadPool() : ThreadPool(absl::GetFlag(FLAGS_num_threads)) {}
+
+ThreadPool::ThreadPool(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.push_back(std::thread(&ThreadPool::work, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  queued_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task) {
+  auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+  std::future<void> res = packaged->get_future();
+  enqueue([packaged]() { (*packaged)(); });
+  return res;
+}
+
+void ThreadPool::parallelFor(int begin, int end,
+                             const std::function<void(int, int)>& f,
+                             int block) {
+  if (begin >= end) {
+    return;
+  }
+  const int n = end - begin;
+  if (block <= 0) {
+    int num_blocks = 4 * (numThreads() + 1);
+    block = (n + num_blocks - 1) / num_blocks;
+  }
+  const int num_blocks = (n + block - 1) / block;
+  if (num_blocks == 1) {
+    f(begin, end);
+    return;
+  }
+
+  // Blocks are claimed through `next`. Helpers which start after all blocks
+  // were claimed return without touching f, which may be gone by then.
+  struct Job {
+    std::atomic<int> next = 0;
+    std::atomic<int> done = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+  auto job = std::make_shared<Job>();
+  auto run = [job, &f, begin, end, block, num_blocks]() {
+    int done = 0;
+    for (int i = job->next++; i < num_blocks; i = job->next++) {
+      int block_begin = begin + i * block;
+      f(block_begin, std::min(end, block_begin + block));
+      done++;
+    }
+    if (done > 0 && (job->done += done) == num_blocks) {
+      std::lock_guard<std::mutex> lock(job->mutex);
+      job->finished.notify_all();
+    }
+  };
+  const int num_helpers = std::min(numThreads(), num_blocks - 1);
+  for (int i = 0; i < num_helpers; ++i) {
+    enqueue(run);
+  }
+  run();
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->finished.wait(lock, [&job, num_blocks]() {
+    return job->done == num_blocks;
+  });
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  queued_.notify_one();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queued_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
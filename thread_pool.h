@@ -0,0 +1,74 @@
+/***
+ * Process-wide pool of worker threads.
+ * Usage:
+ * #include "thread_pool.h"
+ * parallel_for(0, height, [&](int begin, int end) {
+ *   for (int y = begin; y < end; ++y) { ... }
+ * });
+ * std::future<void> done = GlobalThreadPool::instance().submit(task);
+ * done.wait();
+ *
+ * The global pool starts --num_threads workers (one per core by default) on
+ * first use, and they live until the program exits. parallel_for splits a
+ * range into blocks which the workers and the calling thread take in turn, so
+ * uneven blocks are balanced, and it may be nested: if all workers are busy,
+ * the calling thread runs every block itself.
+ ***/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "singleton.h"
+
+class ThreadPool {
+ public:
+  // Uses --num_threads workers.
+  ThreadPool();
+
+  // 0 means one per core.
+  explicit ThreadPool(int num_threads);
+
+  // Finishes the queued tasks.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int numThreads() const { return workers_.size(); }
+
+  std::future<void> submit(std::function<void()> task);
+
+  // Calls f(block_begin, block_end) for blocks of `block` indices covering
+  // [begin, end), and returns once all calls are done. By default blocks are
+  // sized for about 4 per thread.
+  void parallelFor(int begin, int end, const std::function<void(int, int)>& f,
+                   int block = 0);
+
+ private:
+  void enqueue(std::function<void()> task);
+  void work();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_ = false;
+};
+
+SINGLETON(ThreadPool, GlobalThreadPool);
+
+inline void parallel_for(int begin, int end,
+                         const std::function<void(int, int)>& f,
+                         int block = 0) {
+  GlobalThreadPool::instance().parallelFor(begin, end, f, block);
+}
+
+#endif